@@ -1,7 +1,17 @@
 #include <benchmark/benchmark.h>
 #include "distance.h"
+#include "hnsw_index.h"
+#include "write_buffer.h"
+#include "scalar_quantizer.h"
+#include "product_quantizer.h"
+#include "binary_quantizer.h"
+#include <algorithm>
+#include <cstdlib>
+#include <memory>
+#include <numeric>
 #include <vector>
 #include <random>
+#include <string>
 
 // 
 std::vector<float> generate_random_vector(size_t dim) {
@@ -14,6 +24,14 @@ std::vector<float> generate_random_vector(size_t dim) {
     return vec;
 }
 
+// bytes_per_op Ϊÿβȡֽdistances_per_op Ϊÿβľ
+//  bytes_per_second ֱ뱾ڴգdistances/s  ns/op Ϊ
+static void set_throughput(benchmark::State& state, size_t bytes_per_op, size_t distances_per_op) {
+    state.SetBytesProcessed(state.iterations() * bytes_per_op);
+    state.counters["distances/s"] = benchmark::Counter((double)(state.iterations() * distances_per_op),
+                                                       benchmark::Counter::kIsRate);
+}
+
 // 汾
 static void BM_L2DistanceScalar(benchmark::State& state) {
     size_t dim = state.range(0);
@@ -24,22 +42,663 @@ static void BM_L2DistanceScalar(benchmark::State& state) {
         float res = vector_search::l2_distance_scalar(vec_a.data(), vec_b.data(), dim);
         benchmark::DoNotOptimize(res); // ֹѼŻ
     }
+    set_throughput(state, 2 * dim * sizeof(float), 1);
+}
+
+// ָ SIMD ԶӦںˣֵ֧ļֱǷָ
+static void run_kernel(benchmark::State& state, vector_search::SimdLevel level,
+                       vector_search::DistanceFunc (*get_func)(vector_search::SimdLevel)) {
+    if (level > vector_search::detect_simd_level()) {
+        state.SkipWithError("SIMD level not supported on this CPU");
+        return;
+    }
+    vector_search::DistanceFunc func = get_func(level);
+    size_t dim = state.range(0);
+    auto vec_a = generate_random_vector(dim);
+    auto vec_b = generate_random_vector(dim);
+
+    for (auto _ : state) {
+        float res = func(vec_a.data(), vec_b.data(), dim);
+        benchmark::DoNotOptimize(res);
+    }
+    set_throughput(state, 2 * dim * sizeof(float), 1);
+}
+
+// SSE 汾
+static void BM_L2DistanceSSE(benchmark::State& state) {
+    run_kernel(state, vector_search::SimdLevel::SSE, vector_search::get_l2_distance_func);
 }
 
 // AVX2 汾
 static void BM_L2DistanceAVX2(benchmark::State& state) {
+    run_kernel(state, vector_search::SimdLevel::AVX2, vector_search::get_l2_distance_func);
+}
+
+// AVX-512 汾
+static void BM_L2DistanceAVX512(benchmark::State& state) {
+    run_kernel(state, vector_search::SimdLevel::AVX512, vector_search::get_l2_distance_func);
+}
+
+// ڻ SIMD 汾ԣҶͬһںˣ
+static void BM_InnerProductScalar(benchmark::State& state) {
+    run_kernel(state, vector_search::SimdLevel::Scalar, vector_search::get_inner_product_distance_func);
+}
+
+static void BM_InnerProductSSE(benchmark::State& state) {
+    run_kernel(state, vector_search::SimdLevel::SSE, vector_search::get_inner_product_distance_func);
+}
+
+static void BM_InnerProductAVX2(benchmark::State& state) {
+    run_kernel(state, vector_search::SimdLevel::AVX2, vector_search::get_inner_product_distance_func);
+}
+
+static void BM_InnerProductAVX512(benchmark::State& state) {
+    run_kernel(state, vector_search::SimdLevel::AVX512, vector_search::get_inner_product_distance_func);
+}
+
+// ʱַ汾ԣһμӵõĿ
+static void BM_L2DistanceDispatch(benchmark::State& state) {
+    size_t dim = state.range(0);
+    auto vec_a = generate_random_vector(dim);
+    auto vec_b = generate_random_vector(dim);
+    state.SetLabel(vector_search::simd_level_name(vector_search::detect_simd_level()));
+
+    for (auto _ : state) {
+        float res = vector_search::l2_distance(vec_a.data(), vec_b.data(), dim);
+        benchmark::DoNotOptimize(res);
+    }
+    set_throughput(state, 2 * dim * sizeof(float), 1);
+}
+
+// άػں˲ԣͬͨںͬά¶Ա
+static void run_fixed_dim_kernel(benchmark::State& state, vector_search::MetricType metric,
+                                 vector_search::SimdLevel level) {
+    if (level > vector_search::detect_simd_level()) {
+        state.SkipWithError("SIMD level not supported on this CPU");
+        return;
+    }
+    size_t dim = state.range(0);
+    vector_search::DistanceFunc func = vector_search::get_fixed_dim_distance_func(metric, level, dim);
+    auto vec_a = generate_random_vector(dim);
+    auto vec_b = generate_random_vector(dim);
+
+    for (auto _ : state) {
+        float res = func(vec_a.data(), vec_b.data(), dim);
+        benchmark::DoNotOptimize(res);
+    }
+    set_throughput(state, 2 * dim * sizeof(float), 1);
+}
+
+static void BM_L2DistanceAVX2FixedDim(benchmark::State& state) {
+    run_fixed_dim_kernel(state, vector_search::MetricType::L2, vector_search::SimdLevel::AVX2);
+}
+
+static void BM_L2DistanceAVX512FixedDim(benchmark::State& state) {
+    run_fixed_dim_kernel(state, vector_search::MetricType::L2, vector_search::SimdLevel::AVX512);
+}
+
+static void BM_InnerProductAVX2FixedDim(benchmark::State& state) {
+    run_fixed_dim_kernel(state, vector_search::MetricType::InnerProduct, vector_search::SimdLevel::AVX2);
+}
+
+static void BM_InnerProductAVX512FixedDim(benchmark::State& state) {
+    run_fixed_dim_kernel(state, vector_search::MetricType::InnerProduct, vector_search::SimdLevel::AVX512);
+}
+
+// 뾫ں˲ԣѯ fp32Ƚϵ FP16 / BF16 洢
+static void run_half_kernel(benchmark::State& state, vector_search::MetricType metric,
+                            vector_search::VectorStorage storage, vector_search::SimdLevel level) {
+    if (level > vector_search::detect_simd_level()) {
+        state.SkipWithError("SIMD level not supported on this CPU");
+        return;
+    }
+    vector_search::HalfDistanceFunc func = vector_search::get_half_distance_func(metric, storage, level);
     size_t dim = state.range(0);
     auto vec_a = generate_random_vector(dim);
     auto vec_b = generate_random_vector(dim);
+    std::vector<uint16_t> half_b(dim);
+    vector_search::encode_half(storage, vec_b.data(), half_b.data(), dim);
+
+    for (auto _ : state) {
+        float res = func(vec_a.data(), half_b.data(), dim);
+        benchmark::DoNotOptimize(res);
+    }
+    set_throughput(state, dim * (sizeof(float) + sizeof(uint16_t)), 1);
+}
+
+static void BM_L2DistanceFP16Scalar(benchmark::State& state) {
+    run_half_kernel(state, vector_search::MetricType::L2, vector_search::VectorStorage::Float16,
+                    vector_search::SimdLevel::Scalar);
+}
+
+static void BM_L2DistanceFP16AVX2(benchmark::State& state) {
+    run_half_kernel(state, vector_search::MetricType::L2, vector_search::VectorStorage::Float16,
+                    vector_search::SimdLevel::AVX2);
+}
+
+static void BM_L2DistanceBF16AVX2(benchmark::State& state) {
+    run_half_kernel(state, vector_search::MetricType::L2, vector_search::VectorStorage::BFloat16,
+                    vector_search::SimdLevel::AVX2);
+}
+
+static void BM_InnerProductFP16AVX2(benchmark::State& state) {
+    run_half_kernel(state, vector_search::MetricType::InnerProduct, vector_search::VectorStorage::Float16,
+                    vector_search::SimdLevel::AVX2);
+}
+
+static void BM_InnerProductBF16AVX2(benchmark::State& state) {
+    run_half_kernel(state, vector_search::MetricType::InnerProduct, vector_search::VectorStorage::BFloat16,
+                    vector_search::SimdLevel::AVX2);
+}
+
+// ֵֺԣάȣλ
+static void run_hamming_kernel(benchmark::State& state, vector_search::HammingDistanceFunc func,
+                               vector_search::SimdLevel level) {
+    if (level > vector_search::detect_simd_level()) {
+        state.SkipWithError("SIMD level not supported on this CPU");
+        return;
+    }
+    size_t words = (state.range(0) + 63) / 64;
+    std::mt19937_64 gen(42);
+    std::vector<uint64_t> code_a(words), code_b(words);
+    for (size_t i = 0; i < words; ++i) {
+        code_a[i] = gen();
+        code_b[i] = gen();
+    }
 
     for (auto _ : state) {
-        float res = vector_search::l2_distance_avx2(vec_a.data(), vec_b.data(), dim);
+        uint32_t res = func(code_a.data(), code_b.data(), words);
         benchmark::DoNotOptimize(res);
     }
+    set_throughput(state, 2 * words * sizeof(uint64_t), 1);
+}
+
+static void BM_HammingScalar(benchmark::State& state) {
+    run_hamming_kernel(state, vector_search::hamming_distance_scalar, vector_search::SimdLevel::Scalar);
+}
+
+static void BM_HammingPopcnt(benchmark::State& state) {
+    run_hamming_kernel(state, vector_search::hamming_distance_popcnt, vector_search::SimdLevel::SSE);
+}
+
+static void BM_HammingAVX2(benchmark::State& state) {
+    run_hamming_kernel(state, vector_search::hamming_distance_avx2, vector_search::SimdLevel::AVX2);
+}
+
+// дɨ裺6  5  Buffer Engine Ĭͬһ nq ѯ
+// PerQuery ÿѯɨһ飬Batch ÷ֿںѯһɨ衣
+// ÿԣtag = id % 100100 ⻧ǩλͼֻе id % 10 λ
+static std::vector<std::unique_ptr<vector_search::FlatWriteBuffer>>& scan_buffers() {
+    static std::vector<std::unique_ptr<vector_search::FlatWriteBuffer>> buffers = []() {
+        std::vector<std::unique_ptr<vector_search::FlatWriteBuffer>> result;
+        const size_t dim = 128, cap = 50000;
+        std::mt19937 gen(11);
+        std::uniform_real_distribution<float> dis(0.0f, 1.0f);
+        std::vector<float> vec(dim);
+        for (int b = 0; b < 6; ++b) {
+            result.emplace_back(new vector_search::FlatWriteBuffer(cap, dim));
+            for (size_t i = 0; i < cap; ++i) {
+                for (auto& v : vec) v = dis(gen);
+                uint32_t id = (uint32_t)(b * cap + i);
+                result.back()->append_wait_free(vec.data(), id, 0, {id % 100, 1ULL << (id % 10)});
+            }
+        }
+        return result;
+    }();
+    return buffers;
+}
+
+static void run_buffer_scan(benchmark::State& state, bool batched) {
+    auto& buffers = scan_buffers();
+    const size_t dim = 128;
+    size_t nq = state.range(0);
+    std::vector<float> queries(nq * dim);
+    std::mt19937 gen(5);
+    std::uniform_real_distribution<float> dis(0.0f, 1.0f);
+    for (auto& v : queries) v = dis(gen);
+
+    for (auto _ : state) {
+        std::vector<std::priority_queue<vector_search::NodeDist>> tops(nq);
+        for (auto& buffer : buffers) {
+            if (batched) {
+                buffer->search_brute_force_batch(queries.data(), nq, 10, tops.data());
+            } else {
+                for (size_t i = 0; i < nq; ++i) {
+                    buffer->search_brute_force(queries.data() + i * dim, 10, tops[i]);
+                }
+            }
+        }
+        benchmark::DoNotOptimize(tops.data());
+    }
+    // ÿѯÿһξ룻ֽʵʴڴȡƣѯɨÿѯһ
+    size_t buffer_bytes = buffers.size() * 50000 * dim * sizeof(float);
+    set_throughput(state, batched ? buffer_bytes : buffer_bytes * nq, nq * buffers.size() * 50000);
+}
+
+static void BM_BufferScanPerQuery(benchmark::State& state) {
+    run_buffer_scan(state, false);
+}
+
+static void BM_BufferScanBatch(benchmark::State& state) {
+    run_buffer_scan(state, true);
+}
+
+// Թ˵ĵѯɨ裺λͼںɸеĲλֻΪ롣
+// ° Buffer ȫƣ BM_BufferScanPerQuery/1 
+static void run_filtered_scan(benchmark::State& state, const vector_search::AttributeFilter& filter) {
+    auto& buffers = scan_buffers();
+    const size_t dim = 128;
+    std::vector<float> query(dim);
+    std::mt19937 gen(5);
+    std::uniform_real_distribution<float> dis(0.0f, 1.0f);
+    for (auto& v : query) v = dis(gen);
+
+    for (auto _ : state) {
+        std::priority_queue<vector_search::NodeDist> top;
+        for (auto& buffer : buffers) {
+            buffer->search_brute_force(query.data(), 10, top, nullptr, &filter);
+        }
+        benchmark::DoNotOptimize(top);
+    }
+    set_throughput(state, buffers.size() * 50000 * (sizeof(uint32_t) + sizeof(uint64_t)), buffers.size() * 50000);
+}
+
+// 1% ѡʣtag ĳ⻧
+static void BM_BufferScanFilteredTag(benchmark::State& state) {
+    run_filtered_scan(state, vector_search::AttributeFilter::with_tag(7));
+}
+
+// 10% ѡʣǩλͼĳһλ
+static void BM_BufferScanFilteredLabels(benchmark::State& state) {
+    vector_search::AttributeFilter filter;
+    filter.any_labels = 1ULL << 3;
+    run_filtered_scan(state, filter);
+}
+
+// ԹλͼںˣΪλtag ǩλͼͬʱȽ
+static void run_filter_bitmap(benchmark::State& state, vector_search::SimdLevel level) {
+    if (level > vector_search::detect_simd_level()) {
+        state.SkipWithError("SIMD level not supported on this CPU");
+        return;
+    }
+    size_t n = state.range(0);
+    std::vector<uint32_t> tags(n);
+    std::vector<uint64_t> labels(n);
+    std::vector<uint64_t> out((n + 63) / 64);
+    std::mt19937_64 gen(3);
+    for (size_t i = 0; i < n; ++i) {
+        tags[i] = (uint32_t)(gen() % 100);
+        labels[i] = gen();
+    }
+    vector_search::FilterBitmapFunc func = vector_search::get_filter_bitmap_func(level);
+
+    for (auto _ : state) {
+        func(tags.data(), labels.data(), n, 7, 0xFFFFFFFFu, 1ULL << 5, 0, out.data());
+        benchmark::DoNotOptimize(out.data());
+    }
+    set_throughput(state, n * (sizeof(uint32_t) + sizeof(uint64_t)), n);
+}
+
+static void BM_FilterBitmapScalar(benchmark::State& state) {
+    run_filter_bitmap(state, vector_search::SimdLevel::Scalar);
+}
+
+static void BM_FilterBitmapAVX2(benchmark::State& state) {
+    run_filter_bitmap(state, vector_search::SimdLevel::AVX2);
+}
+
+// ԣ붼 64 ֽڶĵַƫ offset  float
+// offset = 0 Ϊ룬offset = 1 ÿ 32 ֽڼض 16 ֽڱ߽硢ֿ绺
+static void BM_L2DistanceAlignment(benchmark::State& state) {
+    size_t dim = state.range(0);
+    size_t offset = state.range(1);
+    state.SetLabel(offset == 0 ? "aligned" : "unaligned");
+    size_t bytes = ((dim + 16) * sizeof(float) + 63) / 64 * 64;
+    float* buf_a = (float*)std::aligned_alloc(64, bytes);
+    float* buf_b = (float*)std::aligned_alloc(64, bytes);
+    auto vec = generate_random_vector(dim);
+    std::copy(vec.begin(), vec.end(), buf_a + offset);
+    std::copy(vec.begin(), vec.end(), buf_b + offset);
+    vector_search::DistanceFunc func = vector_search::get_distance_func(vector_search::MetricType::L2);
+
+    for (auto _ : state) {
+        float res = func(buf_a + offset, buf_b + offset, dim);
+        benchmark::DoNotOptimize(res);
+    }
+    set_throughput(state, 2 * dim * sizeof(float), 1);
+    std::free(buf_a);
+    std::free(buf_b);
+}
+
+// һԶں vs һһںˣһ 32 ھӣڻֻȼ㱾
+// fixed_dim Ϊ true ʱں˰άػHNSW ͼͲѯʵõǸ
+static void run_one_to_many(benchmark::State& state, vector_search::MetricType metric, bool batched,
+                            bool fixed_dim = false) {
+    const size_t n = 32;
+    size_t dim = state.range(0);
+    std::vector<float> base(n * dim);
+    std::mt19937 gen(3);
+    std::uniform_real_distribution<float> dis(0.0f, 1.0f);
+    for (auto& v : base) v = dis(gen);
+    auto query = generate_random_vector(dim);
+    const float* vecs[n];
+    for (size_t i = 0; i < n; ++i) vecs[i] = base.data() + i * dim;
+    float out[n];
+    vector_search::BatchDistanceFunc batch_func = vector_search::get_batch_distance_func(metric, fixed_dim ? dim : 0);
+    vector_search::DistanceFunc func = vector_search::get_distance_func(metric);
+
+    for (auto _ : state) {
+        if (batched) {
+            batch_func(query.data(), vecs, n, dim, out);
+        } else {
+            for (size_t i = 0; i < n; ++i) out[i] = func(query.data(), vecs[i], dim);
+        }
+        benchmark::DoNotOptimize(out);
+    }
+    set_throughput(state, n * dim * sizeof(float), n);
+}
+
+static void BM_OneToManyL2Single(benchmark::State& state) {
+    run_one_to_many(state, vector_search::MetricType::L2, false);
+}
+
+static void BM_OneToManyL2Batch(benchmark::State& state) {
+    run_one_to_many(state, vector_search::MetricType::L2, true);
+}
+
+static void BM_OneToManyInnerProductBatch(benchmark::State& state) {
+    run_one_to_many(state, vector_search::MetricType::InnerProduct, true);
+}
+
+static void BM_OneToManyL2BatchFixedDim(benchmark::State& state) {
+    run_one_to_many(state, vector_search::MetricType::L2, true, true);
+}
+
+static void BM_OneToManyInnerProductBatchFixedDim(benchmark::State& state) {
+    run_one_to_many(state, vector_search::MetricType::InnerProduct, true, true);
+}
+
+// ѯ x ֿںˣ16 ѯ x 256 Ϊά
+static void run_block_dot(benchmark::State& state, vector_search::SimdLevel level) {
+    if (level > vector_search::detect_simd_level()) {
+        state.SkipWithError("SIMD level not supported on this CPU");
+        return;
+    }
+    const size_t nq = 16, nv = 256;
+    size_t dim = state.range(0);
+    std::vector<float> queries(nq * dim), vecs(nv * dim), out(nq * nv);
+    std::mt19937 gen(9);
+    std::uniform_real_distribution<float> dis(0.0f, 1.0f);
+    for (auto& v : queries) v = dis(gen);
+    for (auto& v : vecs) v = dis(gen);
+    vector_search::BlockDotFunc func = vector_search::get_block_dot_func(level);
+
+    for (auto _ : state) {
+        func(queries.data(), nq, vecs.data(), nv, dim, out.data());
+        benchmark::DoNotOptimize(out.data());
+    }
+    set_throughput(state, (nq + nv) * dim * sizeof(float), nq * nv);
+}
+
+static void BM_BlockDotScalar(benchmark::State& state) {
+    run_block_dot(state, vector_search::SimdLevel::Scalar);
+}
+
+static void BM_BlockDotAVX2(benchmark::State& state) {
+    run_block_dot(state, vector_search::SimdLevel::AVX2);
+}
+
+// ==========================================
+// ݷôԣ׿Զ LLCݴ DRAM 룬ںڴжԶ
+// ==========================================
+// ׿СĬ 256MB  fp32 LLC Ļû VS_BENCH_COLD_MB 
+static size_t cold_dataset_bytes() {
+    const char* env = std::getenv("VS_BENCH_COLD_MB");
+    size_t mb = env ? std::strtoul(env, nullptr, 10) : 256;
+    return std::max<size_t>(mb, 16) * 1024 * 1024;
+}
+
+// 洢ʽĵ׿⣬ÿָʽһõʱ
+struct ColdDataset {
+    size_t dim = 0;
+    size_t num = 0;
+    std::vector<float> fp32;
+    std::vector<uint16_t> fp16;
+    std::vector<uint16_t> bf16;
+    vector_search::ScalarQuantizer sq8;
+    std::vector<uint8_t> sq8_codes;
+    vector_search::ProductQuantizer pq;
+    std::vector<uint8_t> pq_codes;
+    vector_search::BinaryQuantizer bin;
+    std::vector<uint64_t> bin_codes;
+    std::vector<uint32_t> hop_order; // ˳ģͼʱھɢ׿
+
+    explicit ColdDataset(size_t d) : dim(d), num(cold_dataset_bytes() / (d * sizeof(float))) {
+        fp32.resize(num * dim);
+        std::mt19937 gen(17);
+        std::uniform_real_distribution<float> dis(0.0f, 1.0f);
+        for (auto& v : fp32) v = dis(gen);
+        hop_order.resize(num);
+        std::iota(hop_order.begin(), hop_order.end(), 0);
+        std::shuffle(hop_order.begin(), hop_order.end(), gen);
+    }
+
+    const uint16_t* half(vector_search::VectorStorage storage) {
+        auto& codes = (storage == vector_search::VectorStorage::Float16) ? fp16 : bf16;
+        if (codes.empty()) {
+            codes.resize(num * dim);
+            for (size_t i = 0; i < num; ++i) {
+                vector_search::encode_half(storage, fp32.data() + i * dim, codes.data() + i * dim, dim);
+            }
+        }
+        return codes.data();
+    }
+
+    const uint8_t* sq8_data() {
+        if (sq8_codes.empty()) {
+            sq8.train(fp32.data(), num, dim);
+            sq8_codes.resize(num * dim);
+            for (size_t i = 0; i < num; ++i) sq8.encode(fp32.data() + i * dim, sq8_codes.data() + i * dim);
+        }
+        return sq8_codes.data();
+    }
+
+    // 뱾Ӱٶȣ
+    const uint8_t* pq_data() {
+        if (pq_codes.empty()) {
+            pq.train(fp32.data(), num, dim, dim / 8, 4, 256 * 16);
+            pq_codes.resize(num * pq.m);
+            for (size_t i = 0; i < num; ++i) pq.encode(fp32.data() + i * dim, pq_codes.data() + i * pq.m);
+        }
+        return pq_codes.data();
+    }
+
+    const uint64_t* bin_data() {
+        if (bin_codes.empty()) {
+            bin.train(fp32.data(), num, dim);
+            bin_codes.resize(num * bin.words);
+            for (size_t i = 0; i < num; ++i) bin.encode(fp32.data() + i * dim, bin_codes.data() + i * bin.words);
+        }
+        return bin_codes.data();
+    }
+};
+
+static ColdDataset& cold_dataset(size_t dim) {
+    static std::vector<std::unique_ptr<ColdDataset>> datasets;
+    for (auto& d : datasets) {
+        if (d->dim == dim) return *d;
+    }
+    datasets.emplace_back(new ColdDataset(dim));
+    return *datasets.back();
+}
+
+enum ColdStorage { kColdFP32 = 0, kColdFP16, kColdBF16, kColdSQ8, kColdPQ, kColdBinary };
+enum ColdAccess { kSequential = 0, kRandomGather, kRandomHopBatch };
+
+static const char* cold_storage_name(int storage) {
+    static const char* names[] = {"FP32", "FP16", "BF16", "SQ8", "PQ(m=dim/8)", "Binary"};
+    return names[storage];
+}
+
+// άȡ洢ʽ (0 = L2, 1 = InnerProduct)ģʽ
+// Sequential ɨ׿⣻RandomGather ˳ʣ
+// RandomHopBatch ˳ÿ 32 һһԶںˣ FP32Ӧ search_layer һ
+static void BM_ColdScan(benchmark::State& state) {
+    size_t dim = state.range(0);
+    int storage = (int)state.range(1);
+    auto metric = state.range(2) == 0 ? vector_search::MetricType::L2 : vector_search::MetricType::InnerProduct;
+    int access = (int)state.range(3);
+    bool quantized = storage == kColdSQ8 || storage == kColdPQ || storage == kColdBinary;
+    if (quantized && metric != vector_search::MetricType::L2) {
+        state.SkipWithError("quantized codes only support L2");
+        return;
+    }
+    if (access == kRandomHopBatch && storage != kColdFP32) {
+        state.SkipWithError("one-to-many kernel only reads FP32 vectors");
+        return;
+    }
+
+    ColdDataset& ds = cold_dataset(dim);
+    auto query = generate_random_vector(dim);
+    const size_t num = ds.num;
+    const uint32_t* order = ds.hop_order.data();
+    auto index_of = [&](size_t i) -> size_t { return access == kSequential ? i : order[i]; };
+    float sink = 0.0f;
+    size_t code_bytes = 0;
+
+    state.SetLabel(std::string(cold_storage_name(storage)) +
+                   (metric == vector_search::MetricType::L2 ? " L2 " : " IP ") +
+                   (access == kSequential ? "sequential" : access == kRandomGather ? "random" : "random-hop-batch"));
+
+    if (storage == kColdFP32) {
+        code_bytes = dim * sizeof(float);
+        const float* base = ds.fp32.data();
+        if (access == kRandomHopBatch) {
+            vector_search::BatchDistanceFunc func = vector_search::get_batch_distance_func(metric);
+            const float* vecs[32];
+            float out[32];
+            for (auto _ : state) {
+                for (size_t i = 0; i + 32 <= num; i += 32) {
+                    for (size_t j = 0; j < 32; ++j) vecs[j] = base + (size_t)order[i + j] * dim;
+                    func(query.data(), vecs, 32, dim, out);
+                    sink += out[0];
+                }
+            }
+        } else {
+            vector_search::DistanceFunc func = vector_search::get_distance_func(metric, dim);
+            for (auto _ : state) {
+                for (size_t i = 0; i < num; ++i) sink += func(query.data(), base + index_of(i) * dim, dim);
+            }
+        }
+    } else if (storage == kColdFP16 || storage == kColdBF16) {
+        auto fmt = storage == kColdFP16 ? vector_search::VectorStorage::Float16 : vector_search::VectorStorage::BFloat16;
+        code_bytes = dim * sizeof(uint16_t);
+        const uint16_t* base = ds.half(fmt);
+        vector_search::HalfDistanceFunc func = vector_search::get_half_distance_func(metric, fmt);
+        for (auto _ : state) {
+            for (size_t i = 0; i < num; ++i) sink += func(query.data(), base + index_of(i) * dim, dim);
+        }
+    } else if (storage == kColdSQ8) {
+        code_bytes = dim;
+        const uint8_t* base = ds.sq8_data();
+        std::vector<uint8_t> q_code(dim);
+        ds.sq8.encode(query.data(), q_code.data());
+        vector_search::Sq8DistanceFunc func = vector_search::get_sq8_l2_distance_func();
+        for (auto _ : state) {
+            for (size_t i = 0; i < num; ++i) sink += (float)func(q_code.data(), base + index_of(i) * dim, dim);
+        }
+    } else if (storage == kColdPQ) {
+        const uint8_t* base = ds.pq_data();
+        size_t m = ds.pq.m;
+        code_bytes = m;
+        std::vector<float> table(m * vector_search::ProductQuantizer::kCentroids);
+        ds.pq.compute_distance_table(query.data(), table.data());
+        vector_search::PqAdcDistanceFunc func = vector_search::get_pq_adc_distance_func();
+        for (auto _ : state) {
+            for (size_t i = 0; i < num; ++i) sink += func(table.data(), base + index_of(i) * m, m);
+        }
+    } else {
+        const uint64_t* base = ds.bin_data();
+        size_t words = ds.bin.words;
+        code_bytes = words * sizeof(uint64_t);
+        std::vector<uint64_t> q_code(words);
+        ds.bin.encode(query.data(), q_code.data());
+        vector_search::HammingDistanceFunc func = vector_search::get_hamming_distance_func(words);
+        for (auto _ : state) {
+            for (size_t i = 0; i < num; ++i) sink += (float)func(q_code.data(), base + index_of(i) * words, words);
+        }
+    }
+    benchmark::DoNotOptimize(sink);
+
+    size_t scored = (access == kRandomHopBatch) ? num / 32 * 32 : num;
+    set_throughput(state, scored * code_bytes, scored);
 }
 
 // ע Benchmark LLM άȣ128, 512, 1024, 4096
 BENCHMARK(BM_L2DistanceScalar)->Arg(128)->Arg(512)->Arg(1024)->Arg(4096);
+BENCHMARK(BM_L2DistanceSSE)->Arg(128)->Arg(512)->Arg(1024)->Arg(4096);
 BENCHMARK(BM_L2DistanceAVX2)->Arg(128)->Arg(512)->Arg(1024)->Arg(4096);
+BENCHMARK(BM_L2DistanceAVX512)->Arg(128)->Arg(512)->Arg(1024)->Arg(4096);
+BENCHMARK(BM_L2DistanceDispatch)->Arg(128)->Arg(512)->Arg(1024)->Arg(4096);
+BENCHMARK(BM_InnerProductScalar)->Arg(128)->Arg(512)->Arg(1024)->Arg(4096);
+BENCHMARK(BM_InnerProductSSE)->Arg(128)->Arg(512)->Arg(1024)->Arg(4096);
+BENCHMARK(BM_InnerProductAVX2)->Arg(128)->Arg(512)->Arg(1024)->Arg(4096);
+BENCHMARK(BM_InnerProductAVX512)->Arg(128)->Arg(512)->Arg(1024)->Arg(4096);
+
+// ػάȶԱȣͨں vs ػںˣ 128/256/384/768/1024/1536
+#define FIXED_DIMS ->Arg(128)->Arg(256)->Arg(384)->Arg(768)->Arg(1024)->Arg(1536)
+BENCHMARK(BM_L2DistanceAVX2) FIXED_DIMS;
+BENCHMARK(BM_L2DistanceAVX2FixedDim) FIXED_DIMS;
+BENCHMARK(BM_L2DistanceAVX512) FIXED_DIMS;
+BENCHMARK(BM_L2DistanceAVX512FixedDim) FIXED_DIMS;
+BENCHMARK(BM_InnerProductAVX2) FIXED_DIMS;
+BENCHMARK(BM_InnerProductAVX2FixedDim) FIXED_DIMS;
+BENCHMARK(BM_InnerProductAVX512) FIXED_DIMS;
+BENCHMARK(BM_InnerProductAVX512FixedDim) FIXED_DIMS;
+
+// 뾫ȴ洢Աȣͬά BM_L2DistanceAVX2 / BM_InnerProductAVX2 
+BENCHMARK(BM_L2DistanceFP16Scalar)->Arg(128)->Arg(768)->Arg(1536);
+BENCHMARK(BM_L2DistanceFP16AVX2)->Arg(128)->Arg(768)->Arg(1536);
+BENCHMARK(BM_L2DistanceBF16AVX2)->Arg(128)->Arg(768)->Arg(1536);
+BENCHMARK(BM_InnerProductFP16AVX2)->Arg(128)->Arg(768)->Arg(1536);
+BENCHMARK(BM_InnerProductBF16AVX2)->Arg(128)->Arg(768)->Arg(1536);
+BENCHMARK(BM_HammingScalar)->Arg(128)->Arg(256)->Arg(512)->Arg(768)->Arg(1536);
+BENCHMARK(BM_HammingPopcnt)->Arg(128)->Arg(256)->Arg(512)->Arg(768)->Arg(1536);
+BENCHMARK(BM_HammingAVX2)->Arg(128)->Arg(256)->Arg(512)->Arg(768)->Arg(1536);
+BENCHMARK(BM_BufferScanPerQuery)->Arg(1)->Arg(8)->Arg(32)->Arg(64)->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_BufferScanBatch)->Arg(1)->Arg(8)->Arg(32)->Arg(64)->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_BufferScanFilteredTag)->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_BufferScanFilteredLabels)->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_FilterBitmapScalar)->Arg(4096)->Arg(50000);
+BENCHMARK(BM_FilterBitmapAVX2)->Arg(4096)->Arg(50000);
+
+
+//  vs Ƕ
+BENCHMARK(BM_L2DistanceAlignment)->ArgsProduct({{128, 768, 1536}, {0, 1}});
+
+// һԶࣺ vs ںˣһ 32 ھӣ
+BENCHMARK(BM_OneToManyL2Single)->Arg(128)->Arg(768)->Arg(1536);
+BENCHMARK(BM_OneToManyL2Batch)->Arg(128)->Arg(768)->Arg(1536);
+BENCHMARK(BM_OneToManyInnerProductBatch)->Arg(128)->Arg(768)->Arg(1536);
+BENCHMARK(BM_OneToManyL2BatchFixedDim)->Arg(128)->Arg(768)->Arg(1536);
+BENCHMARK(BM_OneToManyInnerProductBatchFixedDim)->Arg(128)->Arg(768)->Arg(1536);
+
+// ѯֿ
+BENCHMARK(BM_BlockDotScalar)->Arg(128)->Arg(768);
+BENCHMARK(BM_BlockDotAVX2)->Arg(128)->Arg(768);
+
+// ݣά x 洢ʽ x  x ģʽ
+BENCHMARK(BM_ColdScan)
+    ->ArgNames({"dim", "storage", "metric", "access"})
+    ->ArgsProduct({{128, 768}, {kColdFP32, kColdFP16, kColdBF16}, {0, 1}, {kSequential, kRandomGather}})
+    ->Unit(benchmark::kMillisecond)->Iterations(3);
+BENCHMARK(BM_ColdScan)
+    ->ArgNames({"dim", "storage", "metric", "access"})
+    ->ArgsProduct({{128, 768}, {kColdSQ8, kColdPQ, kColdBinary}, {0}, {kSequential, kRandomGather}})
+    ->Unit(benchmark::kMillisecond)->Iterations(3);
+BENCHMARK(BM_ColdScan)
+    ->ArgNames({"dim", "storage", "metric", "access"})
+    ->ArgsProduct({{128, 768}, {kColdFP32}, {0, 1}, {kRandomHopBatch}})
+    ->Unit(benchmark::kMillisecond)->Iterations(3);
 
 BENCHMARK_MAIN();
\ No newline at end of file
@@ -1,13 +1,29 @@
 #include <iostream>
+#include <cstdlib>
+#include <new>
 #include <chrono>
 #include <thread>
 #include <atomic>
+#include <queue>
+#include <random>
 #include <unordered_set>
+#include <string>
 #include "hnsw_index.h"
 #include "utils.h"
 
 using namespace vector_search;
 
+// ȫֶѷ滻 operator new֤̬ѯǷ
+static std::atomic<size_t> g_alloc_count{0};
+
+void* operator new(size_t size) {
+    g_alloc_count.fetch_add(1, std::memory_order_relaxed);
+    if (void* p = std::malloc(size ? size : 1)) return p;
+    throw std::bad_alloc();
+}
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete(void* p, size_t) noexcept { std::free(p); }
+
 int main() {
     std::cout << "Loading SIFT1M Dataset..." << std::endl;
     
@@ -30,82 +46,479 @@ int main() {
     // --------------------------------------------------------
     //  1̲߳ͼ
     // --------------------------------------------------------
-    std::cout << "\nStarting multi-threaded lock-free insertion..." << std::endl;
     int num_threads = std::thread::hardware_concurrency();
     std::vector<std::thread> threads;
-    std::atomic<size_t> insert_count{0};
-
-    auto start_build = std::chrono::high_resolution_clock::now();
-
-    for (int t = 0; t < num_threads; ++t) {
-        threads.emplace_back([&, t]() {
-            for (size_t i = t; i < base_num; i += num_threads) {
-                index.insert(base_data.data() + i * base_dim, i);
-                insert_count.fetch_add(1, std::memory_order_relaxed);
-                
-                // ӡ
-                if (i % 50000 == 0 && t == 0) {
-                    std::cout << "Inserted " << insert_count.load() << " / " << base_num << " vectors..." << std::endl;
-                }
+
+    //  insert_batchȡȣǰ count н target£/룩
+    auto build_index = [&](HnswIndex& target, size_t count = 0, int build_threads = 0) {
+        if (count == 0) count = base_num;
+        if (build_threads == 0) build_threads = num_threads;
+        std::cout << "\nStarting multi-threaded lock-free insertion (" << build_threads << " threads)..." << std::endl;
+
+        auto start_build = std::chrono::high_resolution_clock::now();
+
+        size_t reported = 0;
+        target.insert_batch(base_data.data(), nullptr, count, build_threads, [&](size_t done, size_t total) {
+            // ӡ
+            if (done / 50000 > reported) {
+                reported = done / 50000;
+                std::cout << "Inserted " << done << " / " << total << " vectors..." << std::endl;
             }
         });
-    }
 
-    for (auto& thread : threads) {
-        thread.join();
-    }
+        auto end_build = std::chrono::high_resolution_clock::now();
+        double build_time = std::chrono::duration<double>(end_build - start_build).count();
+        std::cout << "Build time: " << build_time << " seconds. (Throughput: " 
+                  << count / build_time << " vectors/sec)" << std::endl;
+        return count / build_time;
+    };
 
-    auto end_build = std::chrono::high_resolution_clock::now();
-    double build_time = std::chrono::duration<double>(end_build - start_build).count();
-    std::cout << "Build time: " << build_time << " seconds. (Throughput: " 
-              << base_num / build_time << " vectors/sec)" << std::endl;
+    double insert_throughput = build_index(index);
 
     // --------------------------------------------------------
     //  2ѯٻ (Recall@10) 
     // --------------------------------------------------------
-    std::cout << "\nStarting search benchmark..." << std::endl;
     int k = 10;
     int ef_search = 100; // ̽ȣԽԽ׼Խ
-    std::atomic<int> total_hits{0};
-    
-    auto start_search = std::chrono::high_resolution_clock::now();
-
-    threads.clear();
-    for (int t = 0; t < num_threads; ++t) {
-        threads.emplace_back([&, t]() {
-            for (size_t i = t; i < query_num; i += num_threads) {
-                // ִвѯ
-                auto results = index.search_knn(query_data.data() + i * query_dim, k, ef_search);
-                
-                //  groundtruth Ľ
-                int hits = 0;
-                std::unordered_set<uint32_t> gt_set(groundtruth[i].begin(), groundtruth[i].begin() + k);
-                for (auto res_id : results) {
-                    if (gt_set.count(res_id)) {
-                        hits++;
+    double last_qps = 0.0;
+
+    auto run_search = [&](HnswIndex& target, const char* name) {
+        std::cout << "\nStarting search benchmark (" << name << ")..." << std::endl;
+        std::atomic<int> total_hits{0};
+
+        auto start_search = std::chrono::high_resolution_clock::now();
+
+        threads.clear();
+        for (int t = 0; t < num_threads; ++t) {
+            threads.emplace_back([&, t]() {
+                for (size_t i = t; i < query_num; i += num_threads) {
+                    // ִвѯ
+                    auto results = target.search_knn(query_data.data() + i * query_dim, k, ef_search);
+                    
+                    //  groundtruth Ľ
+                    int hits = 0;
+                    std::unordered_set<uint32_t> gt_set(groundtruth[i].begin(), groundtruth[i].begin() + k);
+                    for (auto res_id : results) {
+                        if (gt_set.count(res_id)) {
+                            hits++;
+                        }
                     }
+                    total_hits.fetch_add(hits, std::memory_order_relaxed);
                 }
-                total_hits.fetch_add(hits, std::memory_order_relaxed);
+            });
+        }
+
+        for (auto& thread : threads) {
+            thread.join();
+        }
+
+        auto end_search = std::chrono::high_resolution_clock::now();
+        double search_time = std::chrono::duration<double>(end_search - start_search).count();
+        
+        double qps = query_num / search_time;
+        last_qps = qps;
+        double recall = (double)total_hits / (query_num * k);
+
+        std::cout << "=============================" << std::endl;
+        std::cout << "Vector Format     : " << name << std::endl;
+        std::cout << "Search Parameters : k=" << k << ", ef_search=" << ef_search << std::endl;
+        std::cout << "Total Search Time : " << search_time << " seconds" << std::endl;
+        std::cout << "QPS (Queries/sec) : " << qps << std::endl;
+        std::cout << "Recall@" << k << "         : " << recall * 100.0 << " %" << std::endl;
+        std::cout << "=============================" << std::endl;
+        return recall;
+    };
+
+    double fp32_recall = run_search(index, "float32");
+    double fp32_qps = last_qps;
+
+    // --------------------------------------------------------
+    //  3SQ8 ֱ + float ţ float32 ͬһͼ϶Ա
+    // --------------------------------------------------------
+    index.train_sq8(base_data.data(), base_num);
+    std::cout << "\nVector memory: float32 = " << base_num * base_dim * sizeof(float) / (1024.0 * 1024.0)
+              << " MB, SQ8 codes = " << index.sq8_memory_bytes() / (1024.0 * 1024.0) << " MB" << std::endl;
+    run_search(index, "SQ8 + float rerank");
+
+    // --------------------------------------------------------
+    //  4PQ ֱ (ADC ) + float 
+    // --------------------------------------------------------
+    size_t pq_m = 16;
+    if (base_dim % pq_m == 0) {
+        auto start_train = std::chrono::high_resolution_clock::now();
+        index.train_pq(base_data.data(), base_num, pq_m);
+        double train_time = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start_train).count();
+        std::cout << "\nPQ training (m=" << pq_m << ") took " << train_time << " seconds" << std::endl;
+        std::cout << "Vector memory: float32 = " << base_num * base_dim * sizeof(float) / (1024.0 * 1024.0)
+                  << " MB, PQ codes + codebook = " << index.pq_memory_bytes() / (1024.0 * 1024.0) << " MB" << std::endl;
+        run_search(index, "PQ + float rerank");
+    }
+
+    // --------------------------------------------------------
+    //  5float  + ֵԤɸ 2  float32 Ա
+    // --------------------------------------------------------
+    index.set_traversal_codec(TraversalCodec::Float32);
+    index.train_binary_prefilter(base_data.data(), base_num);
+    run_search(index, "float32 + binary prefilter");
+    index.set_binary_prefilter(false);
+
+    // --------------------------------------------------------
+    //  6FP16 / BF16 뾫ȴ洢ͬ½ͼԱٻʱ仯
+    // --------------------------------------------------------
+    for (VectorStorage storage : {VectorStorage::Float16, VectorStorage::BFloat16}) {
+        HnswIndex half_index(base_dim, base_num, 16, 200, MetricType::L2, storage);
+        build_index(half_index);
+        std::cout << "\nVector memory: float32 = " << base_num * base_dim * sizeof(float) / (1024.0 * 1024.0)
+                  << " MB, " << vector_storage_name(storage) << " = "
+                  << half_index.vector_memory_bytes() / (1024.0 * 1024.0) << " MB" << std::endl;
+        double recall = run_search(half_index, vector_storage_name(storage));
+        std::cout << "Recall delta vs float32: " << (recall - fp32_recall) * 100.0 << " %" << std::endl;
+    }
+
+    // --------------------------------------------------------
+    //  7Colocated ڵ飨 +  0 ھͬ飩 2  float32 Ա QPS
+    // --------------------------------------------------------
+    {
+        HnswIndex colocated_index(base_dim, base_num, 16, 200, MetricType::L2, VectorStorage::Float32,
+                                  NodeLayout::Colocated);
+        build_index(colocated_index);
+        std::cout << "\nLevel-0 blocks: separate = " << index.level0_memory_bytes() / (1024.0 * 1024.0)
+                  << " MB (+ external vectors), colocated = "
+                  << colocated_index.level0_memory_bytes() / (1024.0 * 1024.0) << " MB" << std::endl;
+        double recall = run_search(colocated_index, "float32 colocated");
+        std::cout << "QPS change vs float32: " << (last_qps / fp32_qps - 1.0) * 100.0 << " %, recall delta: "
+                  << (recall - fp32_recall) * 100.0 << " %" << std::endl;
+    }
+
+    // --------------------------------------------------------
+    //  8ͼ BFS Žڵţ 2  float32 ͬһͼ϶Ա QPS
+    // --------------------------------------------------------
+    {
+        auto start_reorder = std::chrono::high_resolution_clock::now();
+        index.reorder_graph();
+        double reorder_time = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start_reorder).count();
+        std::cout << "\nGraph reorder took " << reorder_time << " seconds" << std::endl;
+        double recall = run_search(index, "float32 reordered");
+        std::cout << "QPS change vs float32: " << (last_qps / fp32_qps - 1.0) * 100.0 << " %, recall delta: "
+                  << (recall - fp32_recall) * 100.0 << " %" << std::endl;
+    }
+
+    // --------------------------------------------------------
+    //  9߳²ͬԤȡĵβѯӳ٣0 ΪرԤȡ
+    // --------------------------------------------------------
+    {
+        int saved_threads = num_threads;
+        num_threads = 1;
+        for (size_t distance : {(size_t)0, (size_t)2, (size_t)4, (size_t)8, (size_t)16}) {
+            index.set_prefetch_distance(distance);
+            std::string name = "float32 reordered, 1 thread, prefetch distance " + std::to_string(distance);
+            run_search(index, name.c_str());
+            std::cout << "Mean latency: " << 1e6 / last_qps << " us" << std::endl;
+        }
+        index.set_prefetch_distance(HnswIndex::kDefaultPrefetchDistance);
+        num_threads = saved_threads;
+    }
+
+    // --------------------------------------------------------
+    //  10ÿβѯĶѷʽ SearchContext ʱ̬ӦΪ 0
+    // --------------------------------------------------------
+    {
+        SearchContext ctx;
+        for (size_t i = 0; i < query_num; ++i) {
+            index.search_knn(query_data.data() + i * query_dim, k, ef_search, ctx); // Ԥȣݵ̬
+        }
+        size_t before = g_alloc_count.load();
+        for (size_t i = 0; i < query_num; ++i) {
+            index.search_knn(query_data.data() + i * query_dim, k, ef_search, ctx);
+        }
+        size_t with_ctx = g_alloc_count.load() - before;
+
+        before = g_alloc_count.load();
+        for (size_t i = 0; i < query_num; ++i) {
+            auto results = index.search_knn(query_data.data() + i * query_dim, k, ef_search);
+        }
+        size_t returning_vector = g_alloc_count.load() - before;
+
+        std::cout << "\nHeap allocations per query: with SearchContext = " << (double)with_ctx / query_num
+                  << ", returning std::vector = " << (double)returning_vector / query_num << std::endl;
+
+        const VisitedTablePool& pool = index.visited_pool();
+        std::cout << "Visited table pool: " << pool.size() << " tables (" << pool.memory_bytes() / (1024.0 * 1024.0)
+                  << " MB, limit " << pool.max_tables() << "), hit rate " << pool.hit_rate() * 100.0
+                  << " %, hash-set fallbacks " << pool.fallbacks() << std::endl;
+    }
+
+    // --------------------------------------------------------
+    //  11ʽ루HnswIndex::insertϲھӱ copy-on-writeȣ
+    // Լϲھӱ slab ռá 1  insert_batch  insert_bulkԭظıݾɱ
+    // ﵥö߳ insert һͼʽ·ĳ޺ slab 
+    // --------------------------------------------------------
+    {
+        size_t stream_num = std::min<size_t>(base_num, 200000);
+        HnswIndex stream_index(base_dim, stream_num, 16, 200);
+        std::cout << "\nStarting streaming insertion (" << num_threads << " threads, " << stream_num
+                  << " vectors)..." << std::endl;
+        auto start_build = std::chrono::high_resolution_clock::now();
+        threads.clear();
+        for (int t = 0; t < num_threads; ++t) {
+            threads.emplace_back([&, t]() {
+                for (size_t i = t; i < stream_num; i += num_threads) {
+                    stream_index.insert(base_data.data() + i * base_dim, i);
+                }
+            });
+        }
+        for (auto& thread : threads) {
+            thread.join();
+        }
+        double build_time = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start_build).count();
+        std::cout << "Streaming build time: " << build_time << " seconds. (Throughput: " << stream_num / build_time
+                  << " vectors/sec)" << std::endl;
+
+        std::cout << "Max degree per level (bound: level 0 = 2M, upper = M):";
+        for (int level = 0; level < 4; ++level) {
+            std::cout << " L" << level << "=" << stream_index.max_degree(level);
+        }
+        std::cout << std::endl;
+        const NeighborListPool& list_pool = NeighborListPool::get_instance();
+        std::cout << "Upper-level neighbor lists: " << list_pool.allocations() << " allocated, slab "
+                  << list_pool.reserved_bytes() / (1024.0 * 1024.0) << " MB reserved, "
+                  << list_pool.live_bytes() / (1024.0 * 1024.0) << " MB live (fragmentation "
+                  << list_pool.fragmentation() * 100.0 << " %)" << std::endl;
+    }
+
+    // --------------------------------------------------------
+    //  12ͼ߳ɨ裨ǰ 20  insert_batch չ
+    // --------------------------------------------------------
+    {
+        size_t sweep_num = std::min<size_t>(base_num, 200000);
+        double single_thread = 0.0;
+        for (int t = 1; t <= num_threads; t *= 2) {
+            HnswIndex sweep_index(base_dim, sweep_num, 16, 200);
+            double throughput = build_index(sweep_index, sweep_num, t);
+            if (t == 1) single_thread = throughput;
+            std::cout << "Threads " << t << ": " << throughput << " vectors/sec, speedup "
+                      << throughput / single_thread << "x (ideal " << t << "x)" << std::endl;
+        }
+    }
+
+    // --------------------------------------------------------
+    //  13NN-Descent ͼ 1  insert_batch ԱȽͼʱٻ
+    // --------------------------------------------------------
+    {
+        HnswIndex nnd_index(base_dim, base_num, 16, 200);
+        std::cout << "\nStarting NN-Descent bulk build (" << num_threads << " threads)..." << std::endl;
+        auto start_build = std::chrono::high_resolution_clock::now();
+        int iterations = nnd_index.build_nndescent(base_data.data(), base_num, num_threads);
+        double build_time = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start_build).count();
+        std::cout << "NN-Descent build time: " << build_time << " seconds (" << iterations
+                  << " iterations), insert_batch: " << base_num / insert_throughput << " seconds" << std::endl;
+        double recall = run_search(nnd_index, "float32 NN-Descent");
+        std::cout << "Recall delta vs insert_batch: " << (recall - fp32_recall) * 100.0 << " %" << std::endl;
+    }
+
+    // --------------------------------------------------------
+    //  14ɾ 10% ԱֻĹͺ̨ͼ֮ٻʡ
+    // ɾʵȡ groundtruth ǰ k δɾ id
+    // --------------------------------------------------------
+    {
+        std::mt19937 rng(42);
+        std::vector<bool> removed(base_num, false);
+        size_t num_deleted = 0;
+        for (size_t id = 0; id < base_num; ++id) {
+            if (rng() % 10 == 0 && index.mark_deleted((uint32_t)id)) {
+                removed[id] = true;
+                ++num_deleted;
             }
-        });
+        }
+
+        auto run_deleted_search = [&](const char* name) {
+            std::atomic<int> total_hits{0};
+            std::atomic<int> leaked{0};
+            threads.clear();
+            for (int t = 0; t < num_threads; ++t) {
+                threads.emplace_back([&, t]() {
+                    for (size_t i = t; i < query_num; i += num_threads) {
+                        auto results = index.search_knn(query_data.data() + i * query_dim, k, ef_search);
+                        std::unordered_set<uint32_t> gt_set;
+                        for (int id : groundtruth[i]) {
+                            if (gt_set.size() == (size_t)k) break;
+                            if (!removed[id]) gt_set.insert(id);
+                        }
+                        int hits = 0;
+                        for (auto res_id : results) {
+                            if (removed[res_id]) leaked.fetch_add(1, std::memory_order_relaxed);
+                            if (gt_set.count(res_id)) hits++;
+                        }
+                        total_hits.fetch_add(hits, std::memory_order_relaxed);
+                    }
+                });
+            }
+            for (auto& thread : threads) {
+                thread.join();
+            }
+            std::cout << name << ": Recall@" << k << " = " << (double)total_hits / (query_num * k) * 100.0
+                      << " %, deleted ids returned: " << leaked.load() << std::endl;
+        };
+
+        std::cout << "\nDeleted " << num_deleted << " vectors (10%)" << std::endl;
+        run_deleted_search("Tombstones only");
+        auto start_repair = std::chrono::high_resolution_clock::now();
+        index.repair_deleted();
+        double repair_time = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start_repair).count();
+        std::cout << "Graph repair took " << repair_time << " seconds" << std::endl;
+        run_deleted_search("After repair");
     }
 
-    for (auto& thread : threads) {
-        thread.join();
+    // --------------------------------------------------------
+    //  15 10% ĴС˹ԭظ£insert ͬһ id  upsert
+    // Աȸ 1 Ĳ£ǰ 100 ѯºݱʵٻ
+    // --------------------------------------------------------
+    {
+        std::mt19937 rng(7);
+        std::normal_distribution<float> noise(0.0f, 2.0f);
+        std::vector<int64_t> update_slot(base_num, -1);
+        std::vector<uint32_t> updated_ids;
+        for (size_t id = 0; id < base_num; ++id) {
+            if (rng() % 10 == 0 && !index.is_deleted((uint32_t)id)) {
+                update_slot[id] = (int64_t)updated_ids.size();
+                updated_ids.push_back((uint32_t)id);
+            }
+        }
+        // Separate ½ڵֱԽ
+        std::vector<float> updated_data(updated_ids.size() * base_dim);
+        for (size_t j = 0; j < updated_ids.size(); ++j) {
+            const float* src = base_data.data() + (size_t)updated_ids[j] * base_dim;
+            for (size_t d = 0; d < base_dim; ++d) updated_data[j * base_dim + d] = src[d] + noise(rng);
+        }
+
+        auto start_update = std::chrono::high_resolution_clock::now();
+        threads.clear();
+        for (int t = 0; t < num_threads; ++t) {
+            threads.emplace_back([&, t]() {
+                for (size_t j = t; j < updated_ids.size(); j += num_threads) {
+                    index.insert(updated_data.data() + j * base_dim, updated_ids[j]);
+                }
+            });
+        }
+        for (auto& thread : threads) {
+            thread.join();
+        }
+        double update_time = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start_update).count();
+        double update_throughput = updated_ids.size() / update_time;
+        std::cout << "\nUpdated " << updated_ids.size() << " vectors in " << update_time << " seconds ("
+                  << update_throughput << " vectors/sec, " << update_throughput / insert_throughput
+                  << "x insert throughput), local refresh: " << index.local_update_count()
+                  << ", full relink: " << index.relink_update_count() << std::endl;
+
+        size_t eval_num = std::min<size_t>(query_num, 100);
+        DistanceFunc l2 = get_distance_func(MetricType::L2, base_dim);
+        int total_hits = 0;
+        for (size_t i = 0; i < eval_num; ++i) {
+            const float* query = query_data.data() + i * query_dim;
+            std::priority_queue<NodeDist> exact;
+            for (size_t id = 0; id < base_num; ++id) {
+                if (index.is_deleted((uint32_t)id)) continue;
+                const float* vec = update_slot[id] >= 0 ? updated_data.data() + update_slot[id] * base_dim
+                                                        : base_data.data() + id * base_dim;
+                float d = l2(query, vec, base_dim);
+                if (exact.size() < (size_t)k || d < exact.top().dist) {
+                    exact.push({(uint32_t)id, d});
+                    if (exact.size() > (size_t)k) exact.pop();
+                }
+            }
+            std::unordered_set<uint32_t> gt_set;
+            for (; !exact.empty(); exact.pop()) gt_set.insert(exact.top().id);
+            for (auto res_id : index.search_knn(query, k, ef_search)) {
+                if (gt_set.count(res_id)) total_hits++;
+            }
+        }
+        std::cout << "After updates: Recall@" << k << " = " << (double)total_hits / (eval_num * k) * 100.0
+                  << " % (" << eval_num << " queries, exact ground truth on updated data)" << std::endl;
     }
 
-    auto end_search = std::chrono::high_resolution_clock::now();
-    double search_time = std::chrono::duration<double>(end_search - start_search).count();
-    
-    double qps = query_num / search_time;
-    double recall = (double)total_hits / (query_num * k);
-
-    std::cout << "=============================" << std::endl;
-    std::cout << "Search Parameters : k=" << k << ", ef_search=" << ef_search << std::endl;
-    std::cout << "Total Search Time : " << search_time << " seconds" << std::endl;
-    std::cout << "QPS (Queries/sec) : " << qps << std::endl;
-    std::cout << "Recall@" << k << "         : " << recall * 100.0 << " %" << std::endl;
-    std::cout << "=============================" << std::endl;
+    // --------------------------------------------------------
+    //  16Թ˲ѯtag = id % 100 ģ 100 ⻧ѡ 1%ǩλͼ id % 10 λ
+    // ѡ 10%Աȱйºˣȡ ef ģٻʺͺʱ
+    // ʵΪǰ 100 ѯﱩ top-k
+    // --------------------------------------------------------
+    {
+        size_t filter_num = std::min<size_t>(base_num, 200000);
+        HnswIndex filter_index(base_dim, filter_num, 16, 200);
+        for (size_t id = 0; id < filter_num; ++id) {
+            filter_index.set_attributes((uint32_t)id, {(uint32_t)(id % 100), 1ULL << (id % 10)});
+        }
+        build_index(filter_index, filter_num);
+
+        size_t eval_num = std::min<size_t>(query_num, 100);
+        DistanceFunc l2 = get_distance_func(MetricType::L2, base_dim);
+        auto run_filtered = [&](const char* name, auto make_filter) {
+            std::vector<std::unordered_set<uint32_t>> gt(eval_num);
+            for (size_t i = 0; i < eval_num; ++i) {
+                AttributeFilter filter = make_filter(i);
+                const float* query = query_data.data() + i * query_dim;
+                std::priority_queue<NodeDist> exact;
+                for (size_t id = 0; id < filter_num; ++id) {
+                    VectorAttributes attrs = filter_index.attributes((uint32_t)id);
+                    if (!filter.matches(attrs.tag, attrs.labels)) continue;
+                    float d = l2(query, base_data.data() + id * base_dim, base_dim);
+                    if (exact.size() < (size_t)k || d < exact.top().dist) {
+                        exact.push({(uint32_t)id, d});
+                        if (exact.size() > (size_t)k) exact.pop();
+                    }
+                }
+                for (; !exact.empty(); exact.pop()) gt[i].insert(exact.top().id);
+            }
+
+            SearchContext ctx;
+            int in_hits = 0, post_hits = 0;
+            auto start = std::chrono::high_resolution_clock::now();
+            for (size_t i = 0; i < eval_num; ++i) {
+                AttributeFilter filter = make_filter(i);
+                for (auto res_id : filter_index.search_knn(query_data.data() + i * query_dim, k, ef_search, ctx, &filter)) {
+                    if (gt[i].count(res_id)) in_hits++;
+                }
+            }
+            double in_time = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count();
+
+            start = std::chrono::high_resolution_clock::now();
+            for (size_t i = 0; i < eval_num; ++i) {
+                AttributeFilter filter = make_filter(i);
+                int kept = 0;
+                for (auto res_id : filter_index.search_knn(query_data.data() + i * query_dim, ef_search, ef_search, ctx)) {
+                    VectorAttributes attrs = filter_index.attributes(res_id);
+                    if (kept == k || !filter.matches(attrs.tag, attrs.labels)) continue;
+                    kept++;
+                    if (gt[i].count(res_id)) post_hits++;
+                }
+            }
+            double post_time = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count();
+
+            std::cout << name << ": in-traversal filter Recall@" << k << " = "
+                      << (double)in_hits / (eval_num * k) * 100.0 << " % (" << in_time * 1e6 / eval_num
+                      << " us/query), post-filter Recall@" << k << " = " << (double)post_hits / (eval_num * k) * 100.0
+                      << " % (" << post_time * 1e6 / eval_num << " us/query)" << std::endl;
+        };
+        run_filtered("Tag filter (1% selectivity)", [](size_t i) { return AttributeFilter::with_tag((uint32_t)(i % 100)); });
+        run_filtered("Label filter (10% selectivity)", [](size_t i) {
+            AttributeFilter filter;
+            filter.any_labels = 1ULL << (i % 10);
+            return filter;
+        });
+
+        // ûκ⻧ΪաչԤΪֻɨУ߱ͼ
+        {
+            AttributeFilter filter = AttributeFilter::with_tag(100);
+            SearchContext ctx;
+            size_t returned = 0;
+            auto start = std::chrono::high_resolution_clock::now();
+            for (size_t i = 0; i < eval_num; ++i) {
+                returned += filter_index.search_knn(query_data.data() + i * query_dim, k, ef_search, ctx, &filter).size();
+            }
+            double empty_time = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count();
+            std::cout << "Tag filter matching nothing: " << returned << " results returned (expected 0), "
+                      << empty_time * 1e6 / eval_num << " us/query" << std::endl;
+        }
+    }
 
     return 0;
 }
\ No newline at end of file
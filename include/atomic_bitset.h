@@ -0,0 +1,46 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+namespace vector_search {
+
+// λͼÿ 64 λһԭ֣λ / λһ fetch_or / fetch_andһ relaxed load
+// ɾĹ"д١ѭ"ı
+class AtomicBitset {
+public:
+    AtomicBitset() : size_(0) {}
+    explicit AtomicBitset(size_t size) : size_(size), words_(new std::atomic<uint64_t>[word_count(size)]) {
+        for (size_t i = 0; i < word_count(size); ++i) words_[i].store(0, std::memory_order_relaxed);
+    }
+
+    size_t size() const { return size_; }
+
+    inline bool test(size_t i) const {
+        return (words_[i >> 6].load(std::memory_order_relaxed) >> (i & 63)) & 1;
+    }
+
+    // λ֮ǰǷλ
+    inline bool set(size_t i) {
+        uint64_t bit = 1ULL << (i & 63);
+        return (words_[i >> 6].fetch_or(bit, std::memory_order_relaxed) & bit) != 0;
+    }
+
+    // λ֮ǰǷλ
+    inline bool reset(size_t i) {
+        uint64_t bit = 1ULL << (i & 63);
+        return (words_[i >> 6].fetch_and(~bit, std::memory_order_relaxed) & bit) != 0;
+    }
+
+    //  w  64 λ֣ȫã
+    inline uint64_t word(size_t w) const { return words_[w].load(std::memory_order_relaxed); }
+
+    static size_t word_count(size_t size) { return (size + 63) / 64; }
+
+private:
+    size_t size_;
+    std::unique_ptr<std::atomic<uint64_t>[]> words_;
+};
+
+} // namespace vector_search
@@ -0,0 +1,39 @@
+#pragma once
+#include <cstdint>
+
+namespace vector_search {
+
+// ÿԣһǩ tenant_idһ 64 λǩλͼÿһλһĿ / Ȩ飩
+struct VectorAttributes {
+    uint32_t tag = 0;
+    uint64_t labels = 0;
+};
+
+// ѯԹͬʱУmatch_tag Ϊ true ʱ tag ȣ
+// labels  all_labels ȫλany_labels  0 ʱ labels ٰһλ
+struct AttributeFilter {
+    bool match_tag = false;
+    uint32_t tag = 0;
+    uint64_t all_labels = 0;
+    uint64_t any_labels = 0;
+
+    static AttributeFilter with_tag(uint32_t tag) {
+        AttributeFilter filter;
+        filter.match_tag = true;
+        filter.tag = tag;
+        return filter;
+    }
+
+    // κ÷ݴֱ޹˵·
+    bool empty() const { return !match_tag && all_labels == 0 && any_labels == 0; }
+
+    // λͼں˵ tag 룺Ƚ tag ʱΪ 0(t & 0) == 0 
+    uint32_t tag_mask() const { return match_tag ? 0xFFFFFFFFu : 0u; }
+
+    inline bool matches(uint32_t t, uint64_t labels) const {
+        return (!match_tag || t == tag) && (labels & all_labels) == all_labels &&
+               (any_labels == 0 || (labels & any_labels) != 0);
+    }
+};
+
+} // namespace vector_search
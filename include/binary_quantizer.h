@@ -0,0 +1,59 @@
+#pragma once
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <random>
+#include <vector>
+
+namespace vector_search {
+
+// 1 bit ֵÿһάάλȽϣλ 1 0
+// ְ 64 λִ֮ĺ루 popcountԷӳǵԶ
+// ֻͼʱǰɸԲܽھӣ
+struct BinaryQuantizer {
+    size_t dim = 0;
+    size_t words = 0;              // ÿֵ 64 λָ
+    std::vector<float> thresholds; // ÿһάλ
+    bool trained = false;
+
+    // ͳÿһάλ max_train 
+    void train(const float* data, size_t n, size_t d, size_t max_train = 10000) {
+        dim = d;
+        words = (dim + 63) / 64;
+        thresholds.assign(dim, 0.0f);
+        if (n == 0) {
+            trained = true; // ûʱ˻Ϊλ
+            return;
+        }
+
+        std::vector<size_t> sample(n);
+        for (size_t i = 0; i < n; ++i) sample[i] = i;
+        if (n > max_train) {
+            std::mt19937 rng(1234);
+            std::shuffle(sample.begin(), sample.end(), rng);
+            sample.resize(max_train);
+        }
+
+        std::vector<float> column(sample.size());
+        for (size_t j = 0; j < dim; ++j) {
+            for (size_t i = 0; i < sample.size(); ++i) {
+                column[i] = data[sample[i] * dim + j];
+            }
+            auto mid = column.begin() + column.size() / 2;
+            std::nth_element(column.begin(), mid, column.end());
+            thresholds[j] = *mid;
+        }
+        trained = true;
+    }
+
+    void encode(const float* x, uint64_t* code) const {
+        std::memset(code, 0, words * sizeof(uint64_t));
+        for (size_t j = 0; j < dim; ++j) {
+            if (x[j] > thresholds[j]) {
+                code[j >> 6] |= (uint64_t)1 << (j & 63);
+            }
+        }
+    }
+};
+
+} // namespace vector_search
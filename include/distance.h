@@ -1,12 +1,172 @@
 #pragma once
 #include <cstddef>
+#include <cstdint>
 
 namespace vector_search {
 
+// ͳһľ뺯ǩ SIMD 屣һ£ʱַ
+using DistanceFunc = float (*)(const float* a, const float* b, size_t dim);
+
+// һԶǩһѯ n ַɢд out[0, n)
+using BatchDistanceFunc = void (*)(const float* query, const float* const* vecs, size_t n,
+                                   size_t dim, float* out);
+
+// SQ8 ־ǩ 8 bit ֮ƽ L2
+using Sq8DistanceFunc = uint32_t (*)(const uint8_t* a, const uint8_t* b, size_t dim);
+
+// PQ ǶԳƾǩѯľ (m x 256) һ m ֽڵ PQ ֲ
+using PqAdcDistanceFunc = float (*)(const float* table, const uint8_t* code, size_t m);
+
+// 뾫ǩѯ fp32Ƚϵ FP16 / BF16 洢
+using HalfDistanceFunc = float (*)(const float* query, const uint16_t* x, size_t dim);
+
+// ֵֺǩ 64 λִ 1 bit 
+using HammingDistanceFunc = uint32_t (*)(const uint64_t* a, const uint64_t* b, size_t words);
+
+// ѯ x ֿǩqueries Ϊ nq x dimvecs Ϊ nv x dim
+// out[i * nv + j] = <queries[i], vecs[j]>
+using BlockDotFunc = void (*)(const float* queries, size_t nq, const float* vecs, size_t nv,
+                              size_t dim, float* out);
+
+// Թλͼǩλ i  (tags[i] & tag_mask) == taglabels[i]  all ȫλ
+//  any Ϊ 0  labels[i] нʱ out ĵ i λout д (n + 63) / 64 ֣ĩֶλ
+using FilterBitmapFunc = void (*)(const uint32_t* tags, const uint64_t* labels, size_t n, uint32_t tag,
+                                  uint32_t tag_mask, uint64_t all, uint64_t any, uint64_t* out);
+
+// CPU ֵ֧ SIMD ָխ
+enum class SimdLevel {
+    Scalar = 0,
+    SSE = 1,
+    AVX2 = 2,   // AVX2 + FMA
+    AVX512 = 3, // AVX-512F
+};
+
+// 
+enum class MetricType {
+    L2 = 0,           // ƽŷϾ
+    InnerProduct = 1, // ڻ붨Ϊ 1 - <a, b>
+    Cosine = 2,       // ңڻںˣڲʱû
+};
+
+// Ĵ洢ȣ뾫Ȱڴͱʱķô
+enum class VectorStorage {
+    Float32 = 0,
+    Float16 = 1,  // IEEE 754 halfȸߡΧС 65504
+    BFloat16 = 2, // fp32 ص 16 λβΧ fp32 ͬȽϵ
+};
+
 // ͨ汾 L2 
 float l2_distance_scalar(const float* a, const float* b, size_t dim);
 
+//  SSE 128 λĴ L2  (x86-64 ߣκλ)
+float l2_distance_sse(const float* a, const float* b, size_t dim);
+
 //  AVX2  FMA ָŻ L2 
 float l2_distance_avx2(const float* a, const float* b, size_t dim);
 
-} // namespace vector_search
\ No newline at end of file
+//  AVX-512F  L2 㣬βأޱѭ
+float l2_distance_avx512(const float* a, const float* b, size_t dim);
+
+// ڻ룺 1 - <a, b> L2 һ"ԽСԽ"ѺͲü߼ֶ
+float inner_product_distance_scalar(const float* a, const float* b, size_t dim);
+float inner_product_distance_sse(const float* a, const float* b, size_t dim);
+float inner_product_distance_avx2(const float* a, const float* b, size_t dim);
+float inner_product_distance_avx512(const float* a, const float* b, size_t dim);
+
+//  1 / ||v|| 0κҾ붼Ϊ 1
+float compute_inv_norm(const float* v, size_t dim);
+
+//  ||v||^2L2 ֿɨʱչ ||q||^2 + ||x||^2 - 2<q, x>
+float compute_sq_norm(const float* v, size_t dim);
+
+// ڻ˻ 1/||x|| õҾ룺1 - <a, b> / (||a|| * ||b||)
+inline float cosine_from_ip_distance(float ip_dist, float inv_norm_a, float inv_norm_b) {
+    return 1.0f - (1.0f - ip_dist) * inv_norm_a * inv_norm_b;
+}
+
+// ̽⵱ǰ CPU ֵ֧ SIMD 𣨽ֻ̽һΣ
+SimdLevel detect_simd_level();
+
+const char* simd_level_name(SimdLevel level);
+
+// ȡָ L2 ںˣ÷豣֤ CPU ָ֧ü
+DistanceFunc get_l2_distance_func(SimdLevel level);
+DistanceFunc get_inner_product_distance_func(SimdLevel level);
+
+// άػںˣ128/256/384/768/1024/1536AVX2 ϣ
+// ѭȫչۼβѭֵ֧άȻ򼶱𷵻 nullptr
+DistanceFunc get_fixed_dim_distance_func(MetricType metric, SimdLevel level, size_t dim);
+
+// ȡںˣdim гάʱȷػ汾dim Ϊ 0 ʾػ
+// Cosine ڻںˣɵ÷ϻķ
+DistanceFunc get_distance_func(MetricType metric, size_t dim = 0);
+
+// һԶںˣͼһھӴ֣ѯֿڼĴб 4 ѡã
+// 4 ·ѡڸǷôӳ٣ԤȡһѡCosine ͬڻ
+BatchDistanceFunc get_batch_distance_func(MetricType metric, SimdLevel level);
+
+// άػһԶںˣά뼶ַ֧Χͬ get_fixed_dim_distance_func֧ʱ nullptr
+BatchDistanceFunc get_fixed_dim_batch_distance_func(MetricType metric, SimdLevel level, size_t dim);
+
+// ȡһԶںˣdim гάʱȷػ汾dim Ϊ 0 ʾػ
+BatchDistanceFunc get_batch_distance_func(MetricType metric, size_t dim = 0);
+
+// SQ8 ֮ L2AVX2 汾չ 16 λ vpmaddwd ƽ
+uint32_t sq8_l2_distance_scalar(const uint8_t* a, const uint8_t* b, size_t dim);
+uint32_t sq8_l2_distance_avx2(const uint8_t* a, const uint8_t* b, size_t dim);
+Sq8DistanceFunc get_sq8_l2_distance_func(SimdLevel level);
+Sq8DistanceFunc get_sq8_l2_distance_func();
+
+// PQ ͣAVX2 汾ÿ vgatherdps ȡ 8 ӿռı
+float pq_adc_distance_scalar(const float* table, const uint8_t* code, size_t m);
+float pq_adc_distance_avx2(const float* table, const uint8_t* code, size_t m);
+PqAdcDistanceFunc get_pq_adc_distance_func(SimdLevel level);
+PqAdcDistanceFunc get_pq_adc_distance_func();
+
+// fp32 <-> 뾫תż룩FP16 ֧ʱ F16C ת
+void encode_half(VectorStorage storage, const float* src, uint16_t* dst, size_t dim);
+void decode_half(VectorStorage storage, const uint16_t* src, float* dst, size_t dim);
+
+// 뾫ںˣʱת fp32FP16  F16C vcvtph2psBF16 λȫ fp32 ۼ
+float l2_distance_fp16_scalar(const float* query, const uint16_t* x, size_t dim);
+float l2_distance_fp16_avx2(const float* query, const uint16_t* x, size_t dim);
+float l2_distance_bf16_scalar(const float* query, const uint16_t* x, size_t dim);
+float l2_distance_bf16_avx2(const float* query, const uint16_t* x, size_t dim);
+float inner_product_distance_fp16_scalar(const float* query, const uint16_t* x, size_t dim);
+float inner_product_distance_fp16_avx2(const float* query, const uint16_t* x, size_t dim);
+float inner_product_distance_bf16_scalar(const float* query, const uint16_t* x, size_t dim);
+float inner_product_distance_bf16_avx2(const float* query, const uint16_t* x, size_t dim);
+
+// ʹ洢ȡںˣFloat32  nullptrCosine ͬڻ
+HalfDistanceFunc get_half_distance_func(MetricType metric, VectorStorage storage, SimdLevel level);
+HalfDistanceFunc get_half_distance_func(MetricType metric, VectorStorage storage);
+
+const char* vector_storage_name(VectorStorage storage);
+
+// 룺popcnt ּAVX2 汾 vpshufb ֽڲ + vpsadbw Լʺϳ
+uint32_t hamming_distance_scalar(const uint64_t* a, const uint64_t* b, size_t words);
+uint32_t hamming_distance_popcnt(const uint64_t* a, const uint64_t* b, size_t words);
+uint32_t hamming_distance_avx2(const uint64_t* a, const uint64_t* b, size_t words);
+HammingDistanceFunc get_hamming_distance_func(SimdLevel level, size_t words);
+HammingDistanceFunc get_hamming_distance_func(size_t words);
+
+// ֿAVX2 ΢ںÿ 4 ѯ x 2 ֿڴһα 4 ѯá
+// дɨһѯһ L2 ֿһ
+void block_dot_scalar(const float* queries, size_t nq, const float* vecs, size_t nv, size_t dim, float* out);
+void block_dot_avx2(const float* queries, size_t nq, const float* vecs, size_t nv, size_t dim, float* out);
+BlockDotFunc get_block_dot_func(SimdLevel level);
+BlockDotFunc get_block_dot_func();
+
+// ԹλͼAVX2 汾һαȽ 8 λ tag ͱǩλͼmovemask ƴ 8 λд
+// дĹɨβλһ飬ֻ֮ΪеĲλ
+void filter_bitmap_scalar(const uint32_t* tags, const uint64_t* labels, size_t n, uint32_t tag,
+                          uint32_t tag_mask, uint64_t all, uint64_t any, uint64_t* out);
+void filter_bitmap_avx2(const uint32_t* tags, const uint64_t* labels, size_t n, uint32_t tag,
+                        uint32_t tag_mask, uint64_t all, uint64_t any, uint64_t* out);
+FilterBitmapFunc get_filter_bitmap_func(SimdLevel level);
+FilterBitmapFunc get_filter_bitmap_func();
+
+// ʱַ L2 룺״εʱ CPU ѡں
+float l2_distance(const float* a, const float* b, size_t dim);
+
+} // namespace vector_search
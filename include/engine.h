@@ -1,12 +1,15 @@
 #pragma once
+#include <chrono>
 #include <thread>
 #include <mutex>
 #include <condition_variable>
 #include <pthread.h>
+#include <array>
 #include <atomic>
 #include <queue>
 #include <vector>
 #include <memory>
+#include <stdexcept>
 #include "hnsw_index.h"
 #include "write_buffer.h"
 
@@ -14,16 +17,29 @@ namespace vector_search {
 
 class VectorEngine {
 public:
+    // ͼ̱߳Ѻٵôòſһʱڵɾܳһһȫͼɨ
+    static constexpr std::chrono::milliseconds kRepairBatchWindow{100};
+
+    // ˢ HNSW ʱ id ֶμĶͬһ id Ķ汾ˢ룬ͬ id 
+    static constexpr size_t kFlushLockStripes = 64;
+
     // Ӻ̨߳ (bg_threads) (soft_limit)Ӳ (hard_limit)
     VectorEngine(size_t dim, size_t max_elements, int M = 16, int ef_construction = 200, 
-                 size_t buffer_cap = 50000, int bg_threads = 2)
-        : dim_(dim), buffer_capacity_(buffer_cap), running_(true),
-          soft_limit_(3), hard_limit_(6) { // ѻ3ʼ٣ѻ6ʼ
+                 size_t buffer_cap = 50000, int bg_threads = 2, MetricType metric = MetricType::L2,
+                 VectorStorage storage = VectorStorage::Float32, NodeLayout layout = NodeLayout::Separate)
+        : dim_(dim), max_elements_(max_elements), buffer_capacity_(buffer_cap), metric_(metric), storage_(storage),
+          running_(true), soft_limit_(3), hard_limit_(6), // ѻ3ʼ٣ѻ6ʼ
+          next_seq_(0), latest_seq_(new std::atomic<uint64_t>[max_elements]),
+          indexed_seq_(new std::atomic<uint64_t>[max_elements]) {
+        for (size_t i = 0; i < max_elements; ++i) {
+            latest_seq_[i].store(0, std::memory_order_relaxed);
+            indexed_seq_[i].store(0, std::memory_order_relaxed);
+        }
         
-        hnsw_index_ = new HnswIndex(dim, max_elements, M, ef_construction);
+        hnsw_index_ = new HnswIndex(dim, max_elements, M, ef_construction, metric_, storage_, layout);
         
         // ʹ shared_ptr  Active Buffer߳
-        active_buffer_ = std::make_shared<FlatWriteBuffer>(buffer_capacity_, dim_);
+        active_buffer_ = std::make_shared<FlatWriteBuffer>(buffer_capacity_, dim_, metric_, storage_, max_elements_);
         
         // ʽ Compaction̨̺߳ͼأ
         int num_cores = std::thread::hardware_concurrency();
@@ -49,26 +65,114 @@ public:
                 }
             }
         }
+
+        // ̨ͼ̣߳ɾܳĽɾڵھ
+        repair_thread_ = std::thread(&VectorEngine::background_repair_loop, this);
     }
 
     ~VectorEngine() {
-        running_.store(false);
+        {
+            //  running_̨߳ڼνʡû wait ʱ
+            //  store + notify յ߳˯ȥҲѲjoin ԶȲ
+            std::scoped_lock lock(swap_mutex_, repair_mutex_);
+            running_.store(false);
+        }
         bg_cv_.notify_all(); // к̨߳˳
+        repair_cv_.notify_all();
         for (auto& t : bg_flush_threads_) {
             if (t.joinable()) t.join();
         }
+        if (repair_thread_.joinable()) repair_thread_.join();
         delete hnsw_index_;
     }
 
     // ¶ײ HNSW ר Server ʱȫ (Bulk Load) ʹ
     HnswIndex* get_raw_index() { return hnsw_index_; }
 
+    // ĳأ÷ brpc handlerԼһ search_knn
+    // ʱ search_knn ڲҲ
+    SearchContextPool& search_context_pool() { return ctx_pool_; }
+
     // ǰ̨д룺ںϱѹС
-    void insert(const float* vec, uint32_t id) {
-        if (active_buffer_->append_wait_free(vec, id)) return;
+    // Ϊ upsertͬһ id ٴдʱ°汾׷ӽ Buffer õţ
+    // ѯֻµһݣˢ HNSW ʱ͵ظ½ڵ½attrs ǹ˲ѯõԣһ
+    void insert(const float* vec, uint32_t id, const VectorAttributes& attrs = VectorAttributes()) {
+        if (id >= max_elements_) {
+            throw std::out_of_range("VectorEngine::insert: id exceeds max_elements");
+        }
+        uint64_t seq = next_seq_.fetch_add(1, std::memory_order_relaxed) + 1;
+        append(vec, id, seq, attrs);
+
+        // ׷ɺŷţ֮ǰѯǾɰ汾֮󿴵°汾
+        uint64_t latest = latest_seq_[id].load(std::memory_order_relaxed);
+        while (latest < seq && !latest_seq_[id].compare_exchange_weak(latest, seq, std::memory_order_release)) {}
+    }
+
+    // ǰ̨ɾдˢ HNSW ģɾٸ HNSW ڵĹ
+    // ͼ޸̨̡߳ id Ƿڹ
+    bool remove(uint32_t id) {
+        std::vector<std::shared_ptr<FlatWriteBuffer>> buffers = snapshot_buffers();
+        bool found = false;
+        for (auto& buffer : buffers) {
+            if (buffer->remove(id) > 0) found = true;
+        }
+        if (hnsw_index_->mark_deleted(id)) {
+            found = true;
+            {
+                std::lock_guard<std::mutex> lock(repair_mutex_);
+                repair_requested_ = true;
+            }
+            repair_cv_.notify_one();
+        }
+        return found;
+    }
+
+    // ǰ̨䰲ȫĿն·鲢
+    // ɽԶ (id, )Buffer  HNSW ľͬһֱӱȽϡ
+    // filter ǿʱֻBuffer ɨλͼĲλͼڱй
+    std::vector<NodeDist> search_knn(const float* query, int k, int ef_search, SearchContext* ctx = nullptr,
+                                     const AttributeFilter* filter = nullptr) {
+        std::priority_queue<NodeDist> top_candidates;
+
+        // Ŀտ shared_ptrʹ̵̨߳˶в
+        // ֻҪ vector ﻹ shared_ptrڴ;԰ȫ
+        std::vector<std::shared_ptr<FlatWriteBuffer>> snapshots = snapshot_buffers();
+
+        // 1. е Immutable Buffer  Active Buffer
+        for (auto& buffer : snapshots) {
+            buffer->search_brute_force(query, k, top_candidates, latest_seq_.get(), filter);
+        }
+
+        // 2. ѵײľ̬ HNSW ͼ Buffer Ľ鲢
+        return merge_index_results(query, k, ef_search, top_candidates, ctx, filter);
+    }
+
+    // ǰ̨һѯһ Buffer ɨ衿
+    // queries Ϊ nq x dim ÿ Buffer ֻڴһ飬÷ֿں˰ѯһꣻ
+    // HNSW ѯ nq  search_knn ȼ
+    std::vector<std::vector<NodeDist>> search_knn_batch(const float* queries, size_t nq, int k, int ef_search,
+                                                        SearchContext* ctx = nullptr) {
+        std::vector<std::priority_queue<NodeDist>> top_candidates(nq);
+        std::vector<std::shared_ptr<FlatWriteBuffer>> snapshots = snapshot_buffers();
+
+        for (auto& buffer : snapshots) {
+            buffer->search_brute_force_batch(queries, nq, k, top_candidates.data(), latest_seq_.get());
+        }
+
+        std::vector<std::vector<NodeDist>> results(nq);
+        for (size_t i = 0; i < nq; ++i) {
+            results[i] = merge_index_results(queries + i * dim_, k, ef_search, top_candidates[i], ctx);
+        }
+        return results;
+    }
+
+private:
+    // ׷ӽ Active Bufferдʱл Bufferжѻʱ
+    void append(const float* vec, uint32_t id, uint64_t seq, const VectorAttributes& attrs) {
+        if (active_buffer_->append_wait_free(vec, id, seq, attrs)) return;
 
         std::unique_lock<std::mutex> lock(swap_mutex_);
-        if (active_buffer_->append_wait_free(vec, id)) return;
+        if (active_buffer_->append_wait_free(vec, id, seq, attrs)) return;
 
         size_t q_size = immutable_queue_.size();
 
@@ -89,62 +193,88 @@ public:
         immutable_queue_.push(active_buffer_);
         
         // ˲µ Active Buffer ӿ
-        active_buffer_ = std::make_shared<FlatWriteBuffer>(buffer_capacity_, dim_);
-        active_buffer_->append_wait_free(vec, id);
+        active_buffer_ = std::make_shared<FlatWriteBuffer>(buffer_capacity_, dim_, metric_, storage_, max_elements_);
+        active_buffer_->append_wait_free(vec, id, seq, attrs);
 
         // һеĺ̨߳ȥɻ
         bg_cv_.notify_one(); 
     }
 
-    // ǰ̨䰲ȫĿն·鲢
-    std::vector<uint32_t> search_knn(const float* query, int k, int ef_search) {
-        std::priority_queue<NodeDist> top_candidates;
-
-        // Ŀտ shared_ptrʹ̵̨߳˶в
-        // ֻҪ vector ﻹ shared_ptrڴ;԰ȫ
-        std::vector<std::shared_ptr<FlatWriteBuffer>> imm_snapshots;
-        std::shared_ptr<FlatWriteBuffer> active_snap;
-        {
-            std::lock_guard<std::mutex> lock(swap_mutex_);
-            active_snap = active_buffer_;
-            
-            // ײ
-            auto q_copy = immutable_queue_;
-            while(!q_copy.empty()) {
-                imm_snapshots.push_back(q_copy.front());
-                q_copy.pop();
-            }
+    // ڿ Immutable BufferActive Buffer Լѳӡˢ HNSW  Buffer  shared_ptr
+    // ˢ Buffer ҲҪɨлûͼʱֻҵ
+    std::vector<std::shared_ptr<FlatWriteBuffer>> snapshot_buffers() {
+        std::vector<std::shared_ptr<FlatWriteBuffer>> snapshots;
+        std::lock_guard<std::mutex> lock(swap_mutex_);
+        
+        // ײ
+        auto q_copy = immutable_queue_;
+        while(!q_copy.empty()) {
+            snapshots.push_back(q_copy.front());
+            q_copy.pop();
         }
+        snapshots.push_back(active_buffer_);
+        snapshots.insert(snapshots.end(), flushing_buffers_.begin(), flushing_buffers_.end());
+        return snapshots;
+    }
 
-        // 1. е Immutable Buffer
-        for (auto& imm_ptr : imm_snapshots) {
-            imm_ptr->search_brute_force(query, k, top_candidates);
+    // ѵײľ̬ HNSW ͼ Buffer Ľ鲢ɽԶǰ k  Buffer ͬһ鲢ʱſɱȣ
+    // ͼѾÿľ룬㡣ͼİ汾µģ°汾 Buffer 
+    // ߻ûˢ꣩ʱBuffer е id Ҳͬһ id һ
+    // ctx Ϊʱʱӳһ
+    std::vector<NodeDist> merge_index_results(const float* query, int k, int ef_search,
+                                              std::priority_queue<NodeDist>& top_candidates, SearchContext* ctx,
+                                              const AttributeFilter* filter = nullptr) {
+        if (ctx == nullptr) {
+            ScopedSearchContext pooled(ctx_pool_);
+            return merge_index_results(query, k, ef_search, top_candidates, pooled.get(), filter);
         }
-
-        // 2.  Active Buffer
-        active_snap->search_brute_force(query, k, top_candidates);
-
-        // 3. ѵײľ̬ HNSW ͼ
-        auto hnsw_results = hnsw_index_->search_knn(query, k, ef_search);
-        for (uint32_t id : hnsw_results) {
-            float d = l2_distance_avx2(query, hnsw_index_->get_node(id)->vector_data, dim_);
-            if (top_candidates.size() < (size_t)k || d < top_candidates.top().dist) {
-                top_candidates.push({id, d});
-                if (top_candidates.size() > (size_t)k) top_candidates.pop();
+        std::vector<NodeDist> result = drain_results(top_candidates);
+        size_t buffered = result.size();
+        // Ҫ޳ࣺ°汾ڻδˢģڣԼѾеġ
+        // ȶȡ buffered ޳֮Դղ k ЧСûȡʱȡ
+        size_t fetch = (size_t)k + buffered;
+        while (true) {
+            int ef = std::max(ef_search, (int)fetch);
+            const std::vector<NodeDist>& hnsw_results =
+                hnsw_index_->search_knn_scored(query, (int)fetch, ef, *ctx, filter);
+            result.resize(buffered);
+            size_t kept = 0;
+            for (const NodeDist& nd : hnsw_results) {
+                if (indexed_seq_[nd.id].load(std::memory_order_acquire) != latest_seq_[nd.id].load(std::memory_order_acquire)) {
+                    continue;
+                }
+                bool duplicate = false;
+                for (size_t i = 0; i < buffered; ++i) {
+                    if (result[i].id == nd.id) {
+                        duplicate = true;
+                        break;
+                    }
+                }
+                if (duplicate) continue;
+                result.push_back(nd);
+                ++kept;
             }
+            if (kept >= (size_t)k || hnsw_results.size() < fetch || fetch >= max_elements_) break;
+            fetch *= 2;
         }
+        // θԭع鲢ض
+        std::inplace_merge(result.begin(), result.begin() + buffered, result.end());
+        if (result.size() > (size_t)k) result.resize(k);
+        return result;
+    }
 
-        std::vector<uint32_t> result;
+    static std::vector<NodeDist> drain_results(std::priority_queue<NodeDist>& top_candidates) {
+        std::vector<NodeDist> result;
         while (!top_candidates.empty()) {
-            result.push_back(top_candidates.top().id);
+            result.push_back(top_candidates.top());
             top_candidates.pop();
         }
         std::reverse(result.begin(), result.end());
         return result;
     }
 
-private:
     void background_flush_loop() {
+        SearchContext flush_ctx; // ÿ̨߳һڸ
         while (running_.load()) {
             std::shared_ptr<FlatWriteBuffer> buffer_to_flush;
             {
@@ -154,19 +284,40 @@ private:
                 
                 buffer_to_flush = immutable_queue_.front();
                 immutable_queue_.pop();
+                flushing_buffers_.push_back(buffer_to_flush); // ˢڼɾҪҵ
             }
 
             // ̨ͼ (HNSW ڲ RCU ֶ֧߳̽ͼ)
             size_t count = buffer_to_flush->count.load(std::memory_order_acquire);
             if (count > buffer_capacity_) count = buffer_capacity_;
             
+            std::vector<float> scratch(dim_);
             for (size_t i = 0; i < count; ++i) {
-                hnsw_index_->insert(buffer_to_flush->data + i * dim_, buffer_to_flush->ids[i]);
+                if (buffer_to_flush->deleted.test(i)) continue;
+                uint32_t id = buffer_to_flush->ids[i];
+                uint64_t seq = buffer_to_flush->seqs[i];
+                if (id >= max_elements_) continue; // лǰλд߿ܻûд꣬id ֵ
+                {
+                    // ͬһ id Ķ汾ܷڲͬ Bufferͬ߳ͬʱˢ룬 id ֶδл
+                    // иµİ汾дʱֱǸ汾ȥ½ڵ
+                    std::lock_guard<std::mutex> lock(flush_locks_[id % kFlushLockStripes]);
+                    if (seq < latest_seq_[id].load(std::memory_order_acquire)) continue;
+                    hnsw_index_->set_attributes(id, {buffer_to_flush->tags[i], buffer_to_flush->labels[i]});
+                    hnsw_index_->insert(buffer_to_flush->vector_at(i, scratch.data()), id, flush_ctx);
+                    indexed_seq_[id].store(seq, std::memory_order_release);
+                }
+                // ڼ䱻ɾɾȱ Buffer ٴĹĹѱβһ
+                if (buffer_to_flush->deleted.test(i)) hnsw_index_->mark_deleted(id);
             }
 
+            // Float32 + Separate ͼڵֱ Buffer Buffer 鵵
+            // 뾫Ȼ Colocated ʱԴһݸBuffer 꼴ͷ
             {
                 std::lock_guard<std::mutex> lock(swap_mutex_);
-                archive_buffers_.push_back(buffer_to_flush);
+                flushing_buffers_.erase(std::find(flushing_buffers_.begin(), flushing_buffers_.end(), buffer_to_flush));
+                if (!hnsw_index_->owns_vectors()) {
+                    archive_buffers_.push_back(buffer_to_flush);
+                }
             }
             // ˢϣ
             // buffer_to_flush 뿪shared_ptr  1
@@ -175,8 +326,25 @@ private:
         }
     }
 
+    // ͼ̣߳ɾʱѣһκ HnswIndex::repair_deleted
+    void background_repair_loop() {
+        std::unique_lock<std::mutex> lock(repair_mutex_);
+        while (running_.load()) {
+            repair_cv_.wait(lock, [this]() { return repair_requested_ || !running_.load(); });
+            if (!running_.load()) break;
+            repair_cv_.wait_for(lock, kRepairBatchWindow, [this]() { return !running_.load(); });
+            repair_requested_ = false;
+            lock.unlock();
+            hnsw_index_->repair_deleted();
+            lock.lock();
+        }
+    }
+
     size_t dim_;
+    size_t max_elements_;
     size_t buffer_capacity_;
+    MetricType metric_;
+    VectorStorage storage_;
     HnswIndex* hnsw_index_;
     
     std::shared_ptr<FlatWriteBuffer> active_buffer_;
@@ -193,6 +361,21 @@ private:
     std::atomic<bool> running_;
 
     std::vector<std::shared_ptr<FlatWriteBuffer>> archive_buffers_;
+    std::vector<std::shared_ptr<FlatWriteBuffer>> flushing_buffers_; // ѳӡˢ HNSW  Buffer
+
+    std::thread repair_thread_;
+    std::mutex repair_mutex_;
+    std::condition_variable repair_cv_;
+    bool repair_requested_ = false;
+
+    // ÿ id дţlatest һд룬indexed ͼﵱǰǷӦд롣
+    // ʱͼĽſɼ Buffer ŵ latest һΪ׼
+    std::atomic<uint64_t> next_seq_;
+    std::unique_ptr<std::atomic<uint64_t>[]> latest_seq_;
+    std::unique_ptr<std::atomic<uint64_t>[]> indexed_seq_;
+    std::array<std::mutex, kFlushLockStripes> flush_locks_;
+
+    SearchContextPool ctx_pool_;
 };
 
 } // namespace vector_search
\ No newline at end of file
@@ -5,30 +5,137 @@
 #include <cmath>
 #include <random>
 #include <mutex>
+#include <thread>
 #include <algorithm>
+#include <new>
+#include <stdexcept>
+#include <string>
 #include <immintrin.h>
+#include "atomic_bitset.h"
+#include "attribute_filter.h"
 #include "distance.h"
 #include "hnsw_node.h"
+#include "neighbor_list_pool.h"
+#include "scalar_quantizer.h"
+#include "product_quantizer.h"
+#include "binary_quantizer.h"
+#include "search_context.h"
+#include "work_stealing.h"
+#include "nndescent.h"
 
 namespace vector_search {
 
-struct NodeDist {
-    uint32_t id;
-    float dist;
-    bool operator<(const NodeDist& other) const { return dist < other.dist; }
-    bool operator>(const NodeDist& other) const { return dist > other.dist; }
+// ͼʱȡʽfloat ֮ĸʽڵ 0 õ ef ѡ float 
+enum class TraversalCodec {
+    Float32 = 0,
+    SQ8 = 1,
+    PQ = 2,
+};
+
+// ڵݲ֡Separate 0 ھڶڽڵ÷ڴ棨뾫ȸ
+// һҪβصڴ棻ColocatedԼ 0 ھӷŽͬһ 64 ֽڶ
+// ڵ飬һֻһڴ棬÷뷵غ󼴿ͷ
+enum class NodeLayout {
+    Separate = 0,
+    Colocated = 1,
 };
 
 class HnswIndex {
 public:
-    // ʼάȡÿھ Mͼ ef_construction
-    HnswIndex(size_t dim, size_t max_elements, int M = 16, int ef_construction = 100)
-        : dim_(dim), max_elements_(max_elements), M_(M), ef_construction_(ef_construction) {
+    // һռھջС
+    static constexpr size_t kBatchSize = 64;
+
+    // ĬԤȡ룺һǰΪǰδھӷԤȡ
+    static constexpr size_t kDefaultPrefetchDistance = 8;
+
+    // ÿԤȡĻಿֽӲ / Ԥȡ
+    static constexpr size_t kPrefetchVectorLines = 4;
+
+    // ef ֵıСϣϼ¼ visitedռȫС visited 
+    static constexpr int kDefaultVisitedHashMaxEf = 64;
+
+    // ĵ 0 չ ef * kFilteredExpansionFactor ѡ̣ܿûκ
+    // tenantʱԶղ ef޾ͻ߱ſɴͼԤ㻹ղ ef ʱΪֻɨĽڵ
+    static constexpr size_t kFilteredExpansionFactor = 8;
+
+    // build_nndescent ͨ޸ÿê ef 
+    static constexpr int kMaxConnectPasses = 4;
+
+    // ʼάȡÿھ Mͼ ef_construction
+    // 洢ȡڵ㲼֡Float32 + Separate ½ڵֱõ÷FP16 / BF16
+    //  Colocated ڲʱԼһݸ֮оֻݸ
+    // ÷ڴ뷵غ󼴿ͷ
+    HnswIndex(size_t dim, size_t max_elements, int M = 16, int ef_construction = 100,
+              MetricType metric = MetricType::L2, VectorStorage storage = VectorStorage::Float32,
+              NodeLayout layout = NodeLayout::Separate)
+        : dim_(dim), max_elements_(max_elements), M_(M), ef_construction_(ef_construction),
+          metric_(metric), storage_(storage), inv_norms_(nullptr), half_vectors_(nullptr), half_stride_(dim),
+          sq8_codes_(nullptr), pq_codes_(nullptr), bin_codes_(nullptr), bin_dist_func_(nullptr), bin_slack_(0),
+          use_binary_prefilter_(false), codec_(TraversalCodec::Float32),
+          prefetch_distance_(kDefaultPrefetchDistance), visited_hash_max_ef_(kDefaultVisitedHashMaxEf),
+          visited_pool_(max_elements, std::max(1u, std::thread::hardware_concurrency())), layout_(layout),
+          tombstones_(max_elements), deleted_count_(0), repaired_count_(0), local_updates_(0), relink_updates_(0) {
+
+        // 0. άȺ CPU ѡںˣ֮о㶼ָ룬
+        //    search_layer ÿһٰάȷ֧
+        dist_func_ = get_distance_func(metric_, dim_);
+        batch_dist_func_ = get_batch_distance_func(metric_, dim_);
+        sq8_dist_func_ = get_sq8_l2_distance_func();
+        pq_dist_func_ = get_pq_adc_distance_func();
+        half_dist_func_ = get_half_distance_func(metric_, storage_);
+        filter_bitmap_func_ = get_filter_bitmap_func();
+
+        // Ҷÿڵ 1/||x|| ڲʱһβ棬Ͳüʱظ
+        if (metric_ == MetricType::Cosine) {
+            inv_norms_ = (float*)std::malloc(max_elements_ * sizeof(float));
+        }
         
         // 1. Ĵ洢һϵͳ޴ġ 64 ֽڶڴ顣
         // ׶ž˶̬ݴָʧЧ⣬ L1/L2 Cache ʡ
         nodes_ = (HnswNode*)std::aligned_alloc(CACHE_LINE_SIZE, max_elements_ * sizeof(HnswNode));
+        // aligned_alloc õĿǸùĶڴ棬ʽ죬 node_lock ֵܴһ"Ѽ"
+        for (size_t i = 0; i < max_elements_; ++i) {
+            new (&nodes_[i]) HnswNode();
+        }
         
+        // 2.  0 ڽӱÿڵ̶ 2 + 2M  uint32 (countcapacity2M λ)
+        // ڵ id ѰַһֱӴ id ַ׷һɢڶϵ NeighborList ָ롣
+        // Colocated ڿף뻺ж룬SIMD زУھӽ
+        // 鲹뵽е
+        size_t links_bytes = (2 + 2 * (size_t)M_) * sizeof(uint32_t);
+        size_t vec_bytes = dim_ * (storage_ == VectorStorage::Float32 ? sizeof(float) : sizeof(uint16_t));
+        if (layout_ == NodeLayout::Colocated) {
+            level0_links_offset_ = (vec_bytes + sizeof(uint32_t) - 1) / sizeof(uint32_t) * sizeof(uint32_t);
+            level0_block_bytes_ = (level0_links_offset_ + links_bytes + CACHE_LINE_SIZE - 1) / CACHE_LINE_SIZE * CACHE_LINE_SIZE;
+        } else {
+            level0_links_offset_ = 0;
+            level0_block_bytes_ = links_bytes;
+        }
+        size_t level0_bytes = (max_elements_ * level0_block_bytes_ + CACHE_LINE_SIZE - 1) / CACHE_LINE_SIZE * CACHE_LINE_SIZE;
+        level0_blocks_ = (char*)std::aligned_alloc(CACHE_LINE_SIZE, level0_bytes);
+        for (size_t i = 0; i < max_elements_; ++i) {
+            NeighborList* list = level0_list((uint32_t)i);
+            list->count = 0;
+            list->capacity = (uint32_t)(2 * M_);
+        }
+
+        // 3. 뾫ȸColocated ¾ڽڵС粽Ѱַ
+        if (storage_ != VectorStorage::Float32) {
+            if (layout_ == NodeLayout::Colocated) {
+                half_vectors_ = (uint16_t*)level0_blocks_;
+                half_stride_ = level0_block_bytes_ / sizeof(uint16_t);
+            } else {
+                size_t bytes = (max_elements_ * vec_bytes + CACHE_LINE_SIZE - 1) / CACHE_LINE_SIZE * CACHE_LINE_SIZE;
+                half_vectors_ = (uint16_t*)std::aligned_alloc(CACHE_LINE_SIZE, bytes);
+            }
+        }
+
+        // 4. УδùԵĽڵ tag Ϊ 0ǩλͼΪ
+        attr_tags_ = (uint32_t*)alloc_codes(sizeof(uint32_t));
+        attr_labels_ = (uint64_t*)alloc_codes(sizeof(uint64_t));
+        std::memset(attr_tags_, 0, max_elements_ * sizeof(uint32_t));
+        std::memset(attr_labels_, 0, max_elements_ * sizeof(uint64_t));
+
         // HNSW ʷֲ
         level_mult_ = 1.0 / std::log(1.0 * M_);
         
@@ -38,7 +145,23 @@ public:
     }
 
     ~HnswIndex() {
+        // ϲھӱԽ̼ slabȥ
+        NeighborListPool& list_pool = NeighborListPool::get_instance();
+        for (size_t i = 0; i < max_elements_; ++i) {
+            for (int level = 1; level < MAX_HNSW_LEVELS; ++level) {
+                NeighborList* list = nodes_[i].neighbor_lists[level].load(std::memory_order_relaxed);
+                if (list != nullptr) list_pool.recycle(list);
+            }
+        }
         std::free(nodes_);
+        std::free(level0_blocks_);
+        std::free(inv_norms_);
+        if (layout_ == NodeLayout::Separate) std::free(half_vectors_);
+        std::free(sq8_codes_);
+        std::free(pq_codes_);
+        std::free(bin_codes_);
+        std::free(attr_tags_);
+        std::free(attr_labels_);
     }
 
     // O(1) ٻȡڵָ
@@ -46,17 +169,196 @@ public:
         return &nodes_[id];
     }
 
+    MetricType metric() const { return metric_; }
+    VectorStorage storage() const { return storage_; }
+    NodeLayout layout() const { return layout_; }
+
+    // ǷԼ÷ڴڲ뷵غ󼴿ͷ
+    bool owns_vectors() const { return storage_ != VectorStorage::Float32 || layout_ == NodeLayout::Colocated; }
+
+    //  0 ڵռõڴ棬Colocated °ϲھӱ䣬ڵ٣룩
+    size_t level0_memory_bytes() const { return max_elements_ * level0_block_bytes_; }
+
+    // level Ѳڵȣ / ׼ãɨȫڵ㣩
+    uint32_t max_degree(int level) const {
+        uint32_t result = 0;
+        for (size_t i = 0; i < max_elements_; ++i) {
+            if (nodes_[i].vector_data == nullptr || nodes_[i].level < level) continue;
+            const NeighborList* list = get_neighbors((uint32_t)i, level);
+            if (list != nullptr) result = std::max(result, list->count);
+        }
+        return result;
+    }
+
+    // Ϊռõڴ棨Float32 + Separate ڵ÷룩
+    size_t vector_memory_bytes() const {
+        if (!owns_vectors()) return 0;
+        return max_elements_ * dim_ * (storage_ == VectorStorage::Float32 ? sizeof(float) : sizeof(uint16_t));
+    }
+
+    // ѯڵľ룻Ҷ query_inv_norm ɵ÷ÿѯԤһ
+    inline float distance_to_node(const float* query, float query_inv_norm, uint32_t id) {
+        float d = half_vectors_ ? half_dist_func_(query, half_vector(id), dim_)
+                                : dist_func_(query, get_node(id)->vector_data, dim_);
+        if (metric_ == MetricType::Cosine) {
+            d = cosine_from_ip_distance(d, query_inv_norm, inv_norms_[id]);
+        }
+        return d;
+    }
+
+    // ѯԤҶ 1/||q||ò 1
+    inline float query_inv_norm(const float* query) const {
+        return metric_ == MetricType::Cosine ? compute_inv_norm(query, dim_) : 1.0f;
+    }
+
+    // һԶ֣ռ ids Ӧַ kBatchSize ֿں
+    inline void distance_to_nodes(const float* query, float query_inv_norm, const uint32_t* ids,
+                                  size_t n, float* out) {
+        if (half_vectors_) {
+            // 뾫ȣת֣ǰ prefetch_distance_ ѡԤȡ
+            for (size_t i = 0; i < n; ++i) {
+                if (prefetch_distance_ > 0 && i + prefetch_distance_ < n) prefetch_vector(ids[i + prefetch_distance_]);
+                out[i] = half_dist_func_(query, half_vector(ids[i]), dim_);
+            }
+        } else {
+            const float* vecs[kBatchSize];
+            for (size_t start = 0; start < n; start += kBatchSize) {
+                size_t len = std::min(kBatchSize, n - start);
+                for (size_t i = 0; i < len; ++i) {
+                    vecs[i] = get_node(ids[start + i])->vector_data;
+                }
+                batch_dist_func_(query, vecs, len, dim_, out + start);
+            }
+        }
+        if (metric_ == MetricType::Cosine) {
+            for (size_t i = 0; i < n; ++i) {
+                out[i] = cosine_from_ip_distance(out[i], query_inv_norm, inv_norms_[ids[i]]);
+            }
+        }
+    }
+
+    // ==========================================
+    // SQ8 ͼ 8 bit ֣ top-k  float 
+    // ==========================================
+    // ѵÿһά min/maxΪѲĽڵ㲹֣ SQ8 
+    // ֮ insert / insert_bulk ڲʱ˳ֱ롣Ӧ bulk load ǰͼɺ
+    // ûвдʱáĿǰֻ֧ L2 
+    void train_sq8(const float* data, size_t n) {
+        if (metric_ != MetricType::L2) {
+            throw std::invalid_argument("SQ8 traversal only supports the L2 metric");
+        }
+        sq8_.train(data, n, dim_);
+        if (sq8_codes_ == nullptr) sq8_codes_ = alloc_codes(dim_);
+        std::vector<float> scratch(dim_);
+        for (size_t id = 0; id < max_elements_; ++id) {
+            const float* vec = node_vector((uint32_t)id, scratch.data());
+            if (vec != nullptr) sq8_.encode(vec, sq8_code((uint32_t)id));
+        }
+        codec_ = TraversalCodec::SQ8;
+    }
+
+    // ==========================================
+    // PQ ˻ͼֻ ADC ÿڵ m ֽ
+    // ==========================================
+    // float ֻھʱʣvector_data ָڴ mmap ӳĵ׿ļ
+    // פڴֻ PQ ֺͼṹԼ train_sq8 ͬdim ܱ m 
+    void train_pq(const float* data, size_t n, size_t m) {
+        if (metric_ != MetricType::L2) {
+            throw std::invalid_argument("PQ traversal only supports the L2 metric");
+        }
+        pq_.train(data, n, dim_, m);
+        std::free(pq_codes_);
+        pq_codes_ = alloc_codes(pq_.m);
+        std::vector<float> scratch(dim_);
+        for (size_t id = 0; id < max_elements_; ++id) {
+            const float* vec = node_vector((uint32_t)id, scratch.data());
+            if (vec != nullptr) pq_.encode(vec, pq_code((uint32_t)id));
+        }
+        codec_ = TraversalCodec::PQ;
+    }
+
+    // ==========================================
+    // ֵԤɸfloat ʱúɸԲܽھ
+    // ==========================================
+    //  ef ֮һﺺ볬"ǰĺ + slack_bits"ھ
+    // ֱ float 롣slack ԽԽأĬȡ dim / 16 λ
+    // Լ train_sq8 ֻͬڲѯͼʼȫȾ
+    void train_binary_prefilter(const float* data, size_t n, int slack_bits = -1) {
+        bin_.train(data, n, dim_);
+        std::free(bin_codes_);
+        bin_codes_ = (uint64_t*)alloc_codes(bin_.words * sizeof(uint64_t));
+        bin_dist_func_ = get_hamming_distance_func(bin_.words);
+        std::vector<float> scratch(dim_);
+        for (size_t id = 0; id < max_elements_; ++id) {
+            const float* vec = node_vector((uint32_t)id, scratch.data());
+            if (vec != nullptr) bin_.encode(vec, bin_code((uint32_t)id));
+        }
+        bin_slack_ = slack_bits >= 0 ? (uint32_t)slack_bits : (uint32_t)(dim_ / 16);
+        use_binary_prefilter_ = true;
+    }
+
+    void set_binary_prefilter(bool enable) { use_binary_prefilter_ = enable && bin_codes_ != nullptr; }
+    bool binary_prefilter() const { return use_binary_prefilter_; }
+
+    // ѵʱлͬһͼ϶ԱȲͬıʽӦֲʱ false
+    bool set_traversal_codec(TraversalCodec codec) {
+        if ((codec == TraversalCodec::SQ8 && sq8_codes_ == nullptr) ||
+            (codec == TraversalCodec::PQ && pq_codes_ == nullptr)) {
+            return false;
+        }
+        codec_ = codec;
+        return true;
+    }
+    TraversalCodec traversal_codec() const { return codec_; }
+
+    // Ԥȡ룺search_layer ÿһΪǰ distance δھǰ / Ԥȡ
+    // ֵѭҲǰ distance ѡԤȡͬʱԤȡһѡھӱ0 ʾرȫԤȡ
+    void set_prefetch_distance(size_t distance) { prefetch_distance_ = distance; }
+    size_t prefetch_distance() const { return prefetch_distance_; }
+
+    // visited ¼ef <= max_ef ıùϣϣ ef ޵ĳ visited 
+    // ÿ max_elements  16 λǣʱͬ˻عϣϡ
+    // Ĭϵ CPU  brpc worker ߳޹
+    void set_visited_hash_max_ef(int max_ef) { visited_hash_max_ef_ = max_ef; }
+    void set_visited_pool_limit(size_t max_tables) { visited_pool_.set_max_tables(max_tables); }
+    const VisitedTablePool& visited_pool() const { return visited_pool_; }
+
+    size_t sq8_memory_bytes() const { return sq8_codes_ ? max_elements_ * dim_ : 0; }
+    size_t pq_memory_bytes() const { return pq_codes_ ? max_elements_ * pq_.m + pq_.codebook_bytes() : 0; }
+
     // ==========================================
     // Ľͼ̸ֶ֧߲߳
     // ==========================================
+    // Ϊ upsertid Ѵʱ update_existing ͵ظֲˢھӣ
+    //  init ڵ㣨ڵָid ɾʱòλ²롣id Խʱ std::out_of_range
     void insert(const float* vector_data, uint32_t id) {
+        insert(vector_data, id, local_context());
+    }
+
+    // ͬϣʽɸõ SearchContext̨ flush ̸߳Գһ
+    void insert(const float* vector_data, uint32_t id, SearchContext& ctx) {
+        id = internal_id(id);
+        if (tombstones_.test(id)) {
+            revive(id);
+        } else if (nodes_[id].vector_data != nullptr) {
+            update_existing(vector_data, id, ctx);
+            return;
+        }
         auto& ebr = EBRManager::get_instance();
         ebr.enter_rcu_read(); // ͼ漰ͼ RCU 
 
         // 1. ʼ½ڵ
         int new_node_level = get_random_level();
+        //  id ԱĽڵָţͼûüĵıߣʱھӱ
+        // õ 0 дŽд
         HnswNode* new_node = get_node(id);
-        new_node->init(vector_data, new_node_level);
+        new_node->begin_write();
+        new_node->init(store_vector(vector_data, id), new_node_level);
+        level0_list(id)->count = 0;
+        float self_inv_norm = init_inv_norm(vector_data, id);
+        encode_codes(vector_data, id);
+        new_node->end_write();
+        FloatDistance self_dist{this, vector_data, self_inv_norm};
 
         int curr_max_level = max_level_.load(std::memory_order_acquire);
 
@@ -73,48 +375,50 @@ public:
         }
 
         uint32_t curr_obj = enter_point_id_.load(std::memory_order_acquire);
-        float curr_dist = l2_distance_avx2(vector_data, get_node(curr_obj)->vector_data, dim_);
+        float curr_dist = self_dist(curr_obj);
 
         // 3. ׶һҵ½ڵòĿڣֱ䣩
         for (int level = curr_max_level; level > new_node_level; --level) {
-            bool changed = true;
-            while (changed) {
-                changed = false;
-                NeighborList* neighbors = get_node(curr_obj)->get_neighbors_rcu(level);
-                if (!neighbors) continue;
-
-                for (uint32_t i = 0; i < neighbors->count; ++i) {
-                    uint32_t candidate_id = neighbors->neighbors[i];
-                    float d = l2_distance_avx2(vector_data, get_node(candidate_id)->vector_data, dim_);
-                    if (d < curr_dist) {
-                        curr_dist = d;
-                        curr_obj = candidate_id;
-                        changed = true;
-                    }
-                }
-            }
+            greedy_search_layer(self_dist, curr_obj, curr_dist, level, ctx);
         }
 
         // 4. ׶ζѰڲ˫
         int min_level = std::min(curr_max_level, new_node_level);
         for (int level = min_level; level >= 0; --level) {
             // ڵǰѰ½ڵ ef_construction ھ
-            auto top_candidates = search_layer(vector_data, curr_obj, ef_construction_, level);
+            search_layer(self_dist, curr_obj, ef_construction_, level, ctx);
+            const std::vector<NodeDist>& top_candidates = ctx.results();
             
-            // ѡ M ˫ (RCU ֤д)
+            // ѡ M ˫
             int num_to_connect = std::min((int)top_candidates.size(), M_);
-            for (int i = 0; i < num_to_connect; ++i) {
-                uint32_t neighbor_id = top_candidates[i];
-                
-                // ӱߣ½ڵ -> ھ
-                new_node->add_neighbor_rcu(level, neighbor_id);
-                // ӱߣھ -> ½ڵ
-                get_node(neighbor_id)->add_neighbor_rcu(level, id);
+            if (level == 0) {
+                //  0 Ƕλ 2M ʽüڵлͬһڵд
+                for (int i = 0; i < num_to_connect; ++i) {
+                    uint32_t neighbor_id = top_candidates[i].id;
+                    HnswNode* neighbor_node = get_node(neighbor_id);
+                    new_node->node_lock.lock();
+                    add_neighbor_inplace(new_node, 0, neighbor_id, M_ * 2);
+                    new_node->node_lock.unlock();
+                    neighbor_node->node_lock.lock();
+                    add_neighbor_inplace(neighbor_node, 0, id, M_ * 2);
+                    neighbor_node->node_lock.unlock();
+                }
+            } else {
+                // ϲ copy-on-write½ڵĳһԷھӵıⶥ M
+                static thread_local std::vector<uint32_t> selected;
+                selected.clear();
+                for (int i = 0; i < num_to_connect; ++i) {
+                    selected.push_back(top_candidates[i].id);
+                }
+                add_neighbors_cow(new_node, level, selected.data(), selected.size(), M_);
+                for (uint32_t neighbor_id : selected) {
+                    add_neighbors_cow(get_node(neighbor_id), level, &id, 1, M_);
+                }
             }
             
             // ׼һ㣬ñҵΪ²
             if (!top_candidates.empty()) {
-                curr_obj = top_candidates[0]; 
+                curr_obj = top_candidates[0].id;
             }
         }
 
@@ -131,16 +435,41 @@ public:
     }
 
     // ר Bulk Load (ȫ) ʹõϵģʽӿ
-    // ԣ0  EBR 0 ڴ Copyԭز
+    // ԣκζ0 ڴ Copyԭز¡ԭ޸ýڵ汾Űס
+    // ڼͬʱѯ޸ĵıض
     void insert_bulk(const float* vector_data, uint32_t id) {
+        insert_bulk(vector_data, id, local_context());
+    }
+
+    void insert_bulk(const float* vector_data, uint32_t id, SearchContext& ctx) {
+        // RCU ٽֻΪʽ벢 copy-on-write ϲֻ̱߳ؼɺ
+        id = internal_id(id);
+        if (tombstones_.test(id)) revive(id);
+        auto& ebr = EBRManager::get_instance();
+        ebr.enter_rcu_read();
         // 1. ʼ½ڵ
         int new_node_level = get_random_level();
         HnswNode* new_node = get_node(id);
         
-        // ע⣺ײ init һ԰Ѹ NeighborList  
-        // Ԥ䵽 M_ (0Ϊ M0_) 
-        new_node->init(vector_data, new_node_level);
+        //  0 λڹʱѰ 2M Ԥ䣬ϲ NeighborList ״ھʱ M һԷ
+        //  insert ͬ id ߣ÷Žд
+        new_node->begin_write();
+        new_node->init(store_vector(vector_data, id), new_node_level);
+        level0_list(id)->count = 0;
+        float self_inv_norm = init_inv_norm(vector_data, id);
+        encode_codes(vector_data, id);
+        new_node->end_write();
+        link_bulk(vector_data, id, new_node_level, self_inv_norm, 0, ctx);
+        ebr.exit_rcu_read();
+    }
 
+    // insert_bulk ߲֣ڵѳʼ߲㽵䣬 [lowest_level, ڵ] ÿһ
+    // ھӲԭؽ˫ߡlowest_level Ϊ 1 ʱֻϲ㣨NN-Descent ͼɵ 0 㣩
+    // ÷ RCU ٽڣid Ϊڲ
+    void link_bulk(const float* vector_data, uint32_t id, int new_node_level, float self_inv_norm,
+                   int lowest_level, SearchContext& ctx) {
+        HnswNode* new_node = get_node(id);
+        FloatDistance self_dist{this, vector_data, self_inv_norm};
         int curr_max_level = max_level_.load(std::memory_order_acquire);
 
         // 2. ͼĵһڵ㣩
@@ -149,45 +478,30 @@ public:
             if (max_level_.load(std::memory_order_acquire) == -1) {
                 enter_point_id_.store(id, std::memory_order_release);
                 max_level_.store(new_node_level, std::memory_order_release);
-                // ɾ ebr.exit_rcu_read();
-                return; 
+                return;
             }
             curr_max_level = max_level_.load(std::memory_order_acquire);
         }
 
         uint32_t curr_obj = enter_point_id_.load(std::memory_order_acquire);
-        float curr_dist = l2_distance_avx2(vector_data, get_node(curr_obj)->vector_data, dim_);
+        float curr_dist = self_dist(curr_obj);
 
         // 3. ׶һҵ½ڵòĿڣֱ䣩
-        // ڵھȫΪûκ̻߳ delete 
+        // ڵھȫԭ޸ĵı汾ضcopy-on-write ϲ RCU 
         for (int level = curr_max_level; level > new_node_level; --level) {
-            bool changed = true;
-            while (changed) {
-                changed = false;
-                NeighborList* neighbors = get_node(curr_obj)->get_neighbors_rcu(level);
-                if (!neighbors) continue;
-
-                for (uint32_t i = 0; i < neighbors->count; ++i) {
-                    uint32_t candidate_id = neighbors->neighbors[i];
-                    float d = l2_distance_avx2(vector_data, get_node(candidate_id)->vector_data, dim_);
-                    if (d < curr_dist) {
-                        curr_dist = d;
-                        curr_obj = candidate_id;
-                        changed = true;
-                    }
-                }
-            }
+            greedy_search_layer(self_dist, curr_obj, curr_dist, level, ctx);
         }
 
         // 4. ׶ζѰڲ˫
         int min_level = std::min(curr_max_level, new_node_level);
-        for (int level = min_level; level >= 0; --level) {
-            // search_layer ڲǴ Bulk Load ҲǾ԰ȫ
-            auto top_candidates = search_layer(vector_data, curr_obj, ef_construction_, level);
+        for (int level = min_level; level >= lowest_level; --level) {
+            // search_layer ֻգ̵߳ԭ޸ɰ汾Ŷ
+            search_layer(self_dist, curr_obj, ef_construction_, level, ctx);
+            const std::vector<NodeDist>& top_candidates = ctx.results();
             
             int num_to_connect = std::min((int)top_candidates.size(), M_);
             for (int i = 0; i < num_to_connect; ++i) {
-                uint32_t neighbor_id = top_candidates[i];
+                uint32_t neighbor_id = top_candidates[i].id;
 
                 int max_m = (level == 0) ? (M_ * 2) : M_;
                 // A. ½ڵ -> ھ (ʵ½ڵ㻹û¶Ҳû£߼ͳһ)
@@ -203,7 +517,7 @@ public:
             }
             
             if (!top_candidates.empty()) {
-                curr_obj = top_candidates[0]; 
+                curr_obj = top_candidates[0].id;
             }
         }
 
@@ -217,48 +531,526 @@ public:
         }
     }
 
+    // ͼ i  data + i * dimΪ ids[i]ids Ϊʱž i
+    // ɹȡ chunk ָ threads ߳ insert_bulk߳ȥ͵ʣµĻ
+    // Ϊ̳߳鵽߲ڵβȫɣprogress ڹ߳ϴе
+    void insert_batch(const float* data, const uint32_t* ids, size_t n, int threads,
+                      const WorkStealingScheduler::Progress& progress = nullptr) {
+        WorkStealingScheduler::run(n, threads, [&](size_t begin, size_t end, int) {
+            SearchContext& ctx = local_context();
+            for (size_t i = begin; i < end; ++i) {
+                insert_bulk(data + i * dim_, ids != nullptr ? ids[i] : (uint32_t)i, ctx);
+            }
+        }, progress);
+    }
+
+    // NN-Descent ͼ insert_bulk ȫ룬ֻڿ
+    // 1.  NN-Descent  kNN ͼk Ĭ 2Mÿһ ef_construction ȵ search_layer
+    // 2. ϲ㣺ֻԼ n / M 㣬԰ insert_bulk ķʽߣֻ 1 㼰ϣ
+    // 3.  0 㣺ÿԼ k ڼһС ef Ľʽ M 
+    //     insert_bulk һԭؽ˫ߣ 2M ü
+    // 4. ֤߱ 0 ȫɴkMaxConnectPasses ֺʱ std::runtime_error
+    //  i  data + i * dimΪ i NN-Descent ĵ
+    int build_nndescent(const float* data, size_t n, int threads = 0,
+                        const NNDescentParams& params = NNDescentParams()) {
+        if (max_level_.load(std::memory_order_acquire) != -1 || !to_external_.empty()) {
+            throw std::logic_error("build_nndescent requires an empty index");
+        }
+        if (n > max_elements_) {
+            throw std::invalid_argument("build_nndescent: more vectors than max_elements");
+        }
+        if (n == 0) return 0;
+
+        // ʼȫڵ㣺֡
+        WorkStealingScheduler::run(n, threads, [&](size_t begin, size_t end, int) {
+            for (size_t i = begin; i < end; ++i) {
+                uint32_t id = (uint32_t)i;
+                const float* vec = data + i * dim_;
+                get_node(id)->init(store_vector(vec, id), get_random_level());
+                level0_list(id)->count = 0;
+                init_inv_norm(vec, id);
+                encode_codes(vec, id);
+            }
+        });
+
+        // 1.  kNN ͼ
+        size_t k = params.k > 0 ? (size_t)params.k : 2 * (size_t)M_;
+        NNDescent knn(n, k, params);
+        int iterations = knn.build([this](uint32_t a, const uint32_t* ids, size_t count, float* out) {
+            distance_from_node(a, ids, count, out);
+        }, threads);
+
+        auto& ebr = EBRManager::get_instance();
+
+        // 2. ϲ㣺ϡӼ
+        std::vector<uint32_t> upper;
+        for (size_t i = 0; i < n; ++i) {
+            if (nodes_[i].level > 0) upper.push_back((uint32_t)i);
+        }
+        WorkStealingScheduler::run(upper.size(), threads, [&](size_t begin, size_t end, int) {
+            SearchContext& ctx = local_context();
+            ebr.enter_rcu_read();
+            for (size_t i = begin; i < end; ++i) {
+                uint32_t id = upper[i];
+                float inv_norm = metric_ == MetricType::Cosine ? inv_norms_[id] : 1.0f;
+                link_bulk(data + (size_t)id * dim_, id, nodes_[id].level, inv_norm, 1, ctx);
+            }
+            ebr.exit_rcu_read();
+        });
+
+        // ȫڵ㶼ֻе 0 ʱСھ 0 Žڵ
+        if (max_level_.load(std::memory_order_acquire) == -1) {
+            std::lock_guard<std::mutex> lock(ep_mutex_);
+            enter_point_id_.store(0, std::memory_order_release);
+            max_level_.store(0, std::memory_order_release);
+        }
+
+        // 3.  0 㣺ѡ = kNN   ѽõͼ link_ef ѵĵ㣬ʽѡ M 
+        //     2M ʱüֻ kNN ѡʱ߶ڴڣͼȱԶ̱ߡɵԲ
+        //    С ef ЩߣԶС ef_construction ȵ
+        int link_ef = params.link_ef > 0 ? params.link_ef : M_;
+        WorkStealingScheduler::run(n, threads, [&](size_t begin, size_t end, int) {
+            SearchContext& ctx = local_context();
+            std::vector<uint32_t> candidates;
+            std::vector<uint32_t> selected(M_);
+            ebr.enter_rcu_read();
+            for (size_t i = begin; i < end; ++i) {
+                uint32_t id = (uint32_t)i;
+                uint32_t count = knn.size(id);
+                const NNDescent::Neighbor* nn = knn.neighbors(id);
+                candidates.clear();
+                for (uint32_t j = 0; j < count; ++j) candidates.push_back(nn[j].id);
+                {
+                    float inv_norm = metric_ == MetricType::Cosine ? inv_norms_[id] : 1.0f;
+                    FloatDistance dist{this, data + i * dim_, inv_norm};
+                    search_from_top(dist, enter_point_id_.load(std::memory_order_acquire),
+                                    max_level_.load(std::memory_order_acquire), link_ef, ctx);
+                    for (const NodeDist& nd : ctx.results()) {
+                        if (nd.id != id && std::find(candidates.begin(), candidates.end(), nd.id) == candidates.end()) {
+                            candidates.push_back(nd.id);
+                        }
+                    }
+                }
+                uint32_t num = select_neighbors_heuristic(id, candidates.data(), candidates.size(), M_, selected.data());
+
+                HnswNode* node = get_node(id);
+                for (uint32_t j = 0; j < num; ++j) {
+                    node->node_lock.lock();
+                    add_neighbor_inplace(node, 0, selected[j], M_ * 2);
+                    node->node_lock.unlock();
+                    HnswNode* neighbor_node = get_node(selected[j]);
+                    neighbor_node->node_lock.lock();
+                    add_neighbor_inplace(neighbor_node, 0, id, M_ * 2);
+                    neighbor_node->node_lock.unlock();
+                }
+            }
+            ebr.exit_rcu_read();
+        });
+
+        // 4. ͨ޸kNN ͼڴ֮䳣ûбߣ뽨ͼȻͨ
+        connect_level0(data, n);
+        return iterations;
+    }
+
+    // ڵ 0  BFS߲ĵѳĿɴ㣨ê㣩һ˫ߡ
+    // ê -> µ߱дȥܶϵκѿɴͨ·êпղλֱ׷ӣ
+    // ˾ͼԶġ BFS ߵھӣھ BFS ĸڵ㲻ê㣩
+    // ֻɾʱ BFS ԭѿɴȻɴֻȲһ߿ֻܾܵĵ㣩
+    // ˿ɴＯֻµê֮ BFS ɣô㡣
+    // ѳĿɴȫûпɼھʱһüӱ ef ê㣻
+    // kMaxConnectPasses ֺвɴ쳣
+    void connect_level0(const float* data, size_t n) {
+        SearchContext& ctx = local_context();
+        const uint32_t max_m = (uint32_t)(2 * M_);
+        std::vector<uint8_t> reached(n, 0);
+        // BFS ÿɴһαʱɵĵ㡣ê㼷ھʱֻڵ㲻Լ
+        std::vector<uint32_t> parent(n, (uint32_t)n);
+        std::vector<uint32_t> queue;
+        std::vector<uint32_t> snapshot(max_m);
+        std::vector<float> dists(max_m);
+        auto bfs = [&](uint32_t start, uint32_t from) {
+            reached[start] = 1;
+            parent[start] = from;
+            queue.assign(1, start);
+            while (!queue.empty()) {
+                uint32_t u = queue.back();
+                queue.pop_back();
+                uint32_t count = read_neighbors(u, 0, snapshot.data());
+                for (uint32_t i = 0; i < count; ++i) {
+                    uint32_t v = snapshot[i];
+                    if (!reached[v]) {
+                        reached[v] = 1;
+                        parent[v] = u;
+                        queue.push_back(v);
+                    }
+                }
+            }
+        };
+
+        //  anchor -> id дêھӱϿκѿɴ㣻дȥʱ false
+        auto link_from = [&](uint32_t anchor, uint32_t id) {
+            HnswNode* anchor_node = get_node(anchor);
+            anchor_node->node_lock.lock();
+            NeighborList* list = level0_list(anchor);
+            uint32_t count = list->count;
+            std::memcpy(snapshot.data(), list->neighbors, count * sizeof(uint32_t));
+            bool linked = std::find(snapshot.begin(), snapshot.begin() + count, id) != snapshot.begin() + count;
+            if (!linked) {
+                uint32_t slot = count;
+                if (count == max_m) {
+                    distance_from_node(anchor, snapshot.data(), count, dists.data());
+                    for (uint32_t j = 0; j < count; ++j) {
+                        if (parent[snapshot[j]] != anchor && (slot == count || dists[j] > dists[slot])) slot = j;
+                    }
+                }
+                if (slot < max_m) {
+                    snapshot[slot] = id;
+                    replace_neighbors(anchor, 0, snapshot.data(), std::max(count, slot + 1));
+                    linked = true;
+                }
+            }
+            anchor_node->node_lock.unlock();
+            return linked;
+        };
+
+        auto& ebr = EBRManager::get_instance();
+        ebr.enter_rcu_read();
+        uint32_t ep = enter_point_id_.load(std::memory_order_acquire);
+        bfs(ep, ep);
+        for (int pass = 0; pass < kMaxConnectPasses; ++pass) {
+            int ef = (int)std::min<size_t>((size_t)ef_construction_ << pass, n);
+            for (size_t i = 0; i < n; ++i) {
+                uint32_t id = (uint32_t)i;
+                if (reached[id]) continue;
+
+                float inv_norm = metric_ == MetricType::Cosine ? inv_norms_[id] : 1.0f;
+                FloatDistance dist{this, data + i * dim_, inv_norm};
+                // ֱӴڵ 0 ѣѵĶǿɴ㣨ϲ㽵ͬɴ
+                search_layer(dist, enter_point_id_.load(std::memory_order_acquire), ef, 0, ctx);
+                const std::vector<NodeDist>& results = ctx.results();
+                // ȹڻпղλêϣһ߶ü
+                uint32_t anchor = (uint32_t)n;
+                for (const NodeDist& nd : results) {
+                    if (level0_list(nd.id)->count < max_m) {
+                        anchor = nd.id;
+                        break;
+                    }
+                }
+                bool linked = anchor != (uint32_t)n && link_from(anchor, id);
+                for (size_t j = 0; !linked && j < results.size(); ++j) {
+                    anchor = results[j].id;
+                    linked = link_from(anchor, id);
+                }
+                if (!linked) continue;
+
+                // µԼĳ߿ճü bfs ֮ǰɴĳ߲κοɴͨ·
+                HnswNode* node = get_node(id);
+                node->node_lock.lock();
+                add_neighbor_inplace(node, 0, anchor, (int)max_m);
+                node->node_lock.unlock();
+                bfs(id, anchor);
+            }
+            // ûϵĵҲܱϵĵյĿɴＯΪ׼
+            size_t unreached = (size_t)std::count(reached.begin(), reached.end(), 0);
+            if (unreached == 0) break;
+            if (pass + 1 == kMaxConnectPasses) {
+                ebr.exit_rcu_read();
+                throw std::runtime_error("connect_level0: " + std::to_string(unreached) +
+                                         " nodes still unreachable from the entry point");
+            }
+        }
+        ebr.exit_rcu_read();
+    }
+
     // ==========================================
     // ӿ (֮ǰ߼һ£)
     // ==========================================
     std::vector<uint32_t> search_knn(const float* query, int k, int ef_search) {
+        return search_knn(query, k, ef_search, local_context());
+    }
+
+    // 汾м״̬ͷص id  ctx ֵ ctx ڲ飬
+    // һʹͬһ ctx ֮ǰЧ̬£ctx ѾͬȹģĲѯκζѷ䡣
+    // filter ǿʱֻĽڵ㣬 search_knn_scored
+    const std::vector<uint32_t>& search_knn(const float* query, int k, int ef_search, SearchContext& ctx,
+                                            const AttributeFilter* filter = nullptr) {
+        const std::vector<NodeDist>& scored = search_knn_scored(query, k, ef_search, ctx, filter);
+        std::vector<uint32_t>& top_k = ctx.ids();
+        top_k.clear();
+        for (const NodeDist& nd : scored) {
+            top_k.push_back(nd.id);
+        }
+        return top_k;
+    }
+
+    // ɽԶ (÷ id, )Ǳ / ʱ float 룬
+    //  distance_to_node һ£L2 Ϊƽ룬ڻΪ 1 - ƶȣ÷һ顣
+    // ֵ ctx ڲ飬ͬ search_knn
+    // filter ǿʱڵ 0 нУĽڵճչ䵱ͨڵţ
+    // ֻǲѣѴ ef Ľڵ֮ǰͣºٻظߵö࣬
+    // Խ߹ĽڵԽࣺչ ef * kFilteredExpansionFactor ͣ
+    // ʱѻղ ef ˵Ľڵϡ裬Ϊ filtered_scan ֻǴ
+    const std::vector<NodeDist>& search_knn_scored(const float* query, int k, int ef_search, SearchContext& ctx,
+                                                   const AttributeFilter* filter = nullptr) {
         auto& ebr = EBRManager::get_instance();
         ebr.enter_rcu_read();
+        if (filter != nullptr && filter->empty()) filter = nullptr;
 
+        std::vector<NodeDist>& results = ctx.results();
         int curr_max_level = max_level_.load(std::memory_order_acquire);
         if (curr_max_level == -1) {
             ebr.exit_rcu_read();
-            return {};
+            results.clear();
+            return results;
         }
 
-        uint32_t curr_obj = enter_point_id_.load(std::memory_order_acquire);
-        float curr_dist = l2_distance_avx2(query, get_node(curr_obj)->vector_data, dim_);
-
-        for (int level = curr_max_level; level >= 1; --level) {
-            bool changed = true;
-            while (changed) {
-                changed = false;
-                NeighborList* neighbors = get_node(curr_obj)->get_neighbors_rcu(level);
-                if (!neighbors) continue;
-
-                for (uint32_t i = 0; i < neighbors->count; ++i) {
-                    uint32_t candidate_id = neighbors->neighbors[i];
-                    float d = l2_distance_avx2(query, get_node(candidate_id)->vector_data, dim_);
-                    if (d < curr_dist) {
-                        curr_dist = d;
-                        curr_obj = candidate_id;
-                        changed = true;
+        uint32_t ep_id = enter_point_id_.load(std::memory_order_acquire);
+        FloatDistance float_dist{this, query, query_inv_norm(query)};
+        int ef = std::max(k, ef_search);
+        bool complete = true;
+
+        if (codec_ == TraversalCodec::SQ8) {
+            // SQ8ѯҲ֣ȫֻ 1/4 С֣
+            //  0 õ ef ѡ float ţ
+            std::vector<uint8_t>& query_code = ctx.sq8_code();
+            query_code.resize(dim_);
+            sq8_.encode(query, query_code.data());
+            Sq8Distance code_dist{this, query_code.data()};
+            complete = search_from_top(code_dist, ep_id, curr_max_level, ef, ctx, filter);
+            rerank(float_dist, ctx, k);
+        } else if (codec_ == TraversalCodec::PQ) {
+            // PQÿѯȽһ m x 256 ľ֮ÿڵľֻ m β
+            std::vector<float>& table = ctx.pq_table();
+            table.resize(pq_.m * ProductQuantizer::kCentroids);
+            pq_.compute_distance_table(query, table.data());
+            PqDistance code_dist{this, table.data()};
+            complete = search_from_top(code_dist, ep_id, curr_max_level, ef, ctx, filter);
+            rerank(float_dist, ctx, k);
+        } else if (use_binary_prefilter_) {
+            // ֵԤɸϲ̰½ float 0 㾫ʱȹ
+            std::vector<uint64_t>& query_code = ctx.bin_code();
+            query_code.resize(bin_.words);
+            bin_.encode(query, query_code.data());
+            BinaryScreenedDistance screened{float_dist, query_code.data(), bin_slack_};
+            complete = search_from_top(screened, ep_id, curr_max_level, ef, ctx, filter);
+            stable_top_k(float_dist, ctx, k);
+        } else {
+            complete = search_from_top(float_dist, ep_id, curr_max_level, ef, ctx, filter);
+            stable_top_k(float_dist, ctx, k);
+        }
+        if (!complete) {
+            filtered_scan(float_dist, k, ctx, *filter);
+        }
+
+        ebr.exit_rcu_read();
+
+        if (results.size() > (size_t)k) results.resize(k);
+        for (NodeDist& nd : results) {
+            nd.id = external_id(nd.id);
+        }
+        return results;
+    }
+
+    // ¼ֲˢµĴƯƹߵĴ
+    uint64_t local_update_count() const { return local_updates_.load(std::memory_order_relaxed); }
+    uint64_t relink_update_count() const { return relink_updates_.load(std::memory_order_relaxed); }
+
+    // ==========================================
+    // ԣ˲ѯ
+    // ==========================================
+    //  id ԡ insert ֮ǰãڵһͼʹȷԣ
+    // ͼĽڵԲӰͼṹֻӰ֮Ĺ˲ѯ
+    //  insertattributes ͬid Խʱ std::out_of_range
+    void set_attributes(uint32_t id, const VectorAttributes& attrs) {
+        id = internal_id(id);
+        attr_tags_[id] = attrs.tag;
+        attr_labels_[id] = attrs.labels;
+    }
+
+    VectorAttributes attributes(uint32_t id) const {
+        id = internal_id(id);
+        return {attr_tags_[id], attr_labels_[id]};
+    }
+
+    // ==========================================
+    // ɾĹ + ̨ͼ
+    // ==========================================
+    // ɾֻĹڵͼ䵱ͨ·search_layer ճŽ
+    // ʱҲrepair_deleted ɺ̵̨߳ãָɾڵı߸Ľӵǵھϣ
+    // ɾڵԼھӱ֮ͬһ id ²ʱֱӸλ
+    //  id ǰǷδɾ
+    bool mark_deleted(uint32_t id) {
+        if (id >= max_elements_) return false;
+        id = internal_id(id);
+        if (nodes_[id].vector_data == nullptr) return false;
+        std::lock_guard<std::mutex> lock(delete_mutex_);
+        if (tombstones_.set(id)) return false;
+        deleted_count_.fetch_add(1, std::memory_order_relaxed);
+        pending_repair_.push_back(id);
+        return true;
+    }
+
+    bool is_deleted(uint32_t id) const { return id < max_elements_ && tombstones_.test(internal_id(id)); }
+
+    // ĹĽڵͼȴͬһ id ²Ĳλ
+    size_t deleted_count() const { return deleted_count_.load(std::memory_order_relaxed); }
+    size_t pending_repair_count() const {
+        std::lock_guard<std::mutex> lock(delete_mutex_);
+        return pending_repair_.size();
+    }
+    uint64_t repaired_count() const { return repaired_count_.load(std::memory_order_relaxed); }
+
+    // ̨ͼÿڵĳָɾڵʱѡ = Ĵھ  ɾھӵĴھӣ
+    // ʽѡò޵ھӡ 0 ԭظд汾űϲ copy-on-write
+    // ɱ EBR ںص slabձɾڵԼĸھӱ
+    // һҪɨһȫͼɾܳ޸㡣ر޸ɾڵε֮䴮
+    size_t repair_deleted() {
+        std::lock_guard<std::mutex> repair_lock(repair_mutex_);
+        std::vector<uint32_t> batch;
+        {
+            std::lock_guard<std::mutex> lock(delete_mutex_);
+            batch.swap(pending_repair_);
+        }
+        if (batch.empty()) return 0;
+
+        auto& ebr = EBRManager::get_instance();
+        ebr.enter_rcu_read();
+        replace_deleted_enter_point();
+        for (size_t i = 0; i < max_elements_; ++i) {
+            uint32_t id = (uint32_t)i;
+            const HnswNode& node = nodes_[id];
+            if (node.vector_data == nullptr || tombstones_.test(id)) continue;
+            for (int level = 0; level <= node.level && level < MAX_HNSW_LEVELS; ++level) {
+                repair_neighbors(id, level);
+            }
+        }
+        for (uint32_t id : batch) {
+            clear_neighbors(id);
+        }
+        ebr.exit_rcu_read();
+        ebr.collect(); // ƽԪݵϲ
+        repaired_count_.fetch_add(batch.size(), std::memory_order_relaxed);
+        return batch.size();
+    }
+
+    // ==========================================
+    // ͼţͼڽӹϵڵ±ţûΪھӵĽڵڴﰤһ
+    // ==========================================
+    // ڵڵ 0  BFSھӰ˳ӣɽԶ˳·ڲ id
+    // ͨĲְԭ id ˳ BFS±ֻѲڵռõ id ڲû
+    // δռõ id ֲ䣬֮ĲȻֱʹõ÷ id
+    // ڵ㡢ھӱȫֶ±ŰǨsearch_knn ͨ id ӳ䷵ص÷ id
+    // ûκβдʱã bulk load ɺ󡢿ʼǰ
+    void reorder_graph() {
+        // 1. Ѳڵڲ id
+        std::vector<uint32_t> occupied;
+        for (size_t id = 0; id < max_elements_; ++id) {
+            if (nodes_[id].vector_data != nullptr) occupied.push_back((uint32_t)id);
+        }
+        if (occupied.size() < 2) return;
+
+        // 2. BFS ˳
+        std::vector<uint32_t> order;
+        order.reserve(occupied.size());
+        std::vector<bool> seen(max_elements_, false);
+        auto bfs_from = [&](uint32_t root) {
+            if (seen[root]) return;
+            seen[root] = true;
+            size_t head = order.size();
+            order.push_back(root);
+            while (head < order.size()) {
+                NeighborList* list = level0_list(order[head++]);
+                for (uint32_t i = 0; i < list->count; ++i) {
+                    uint32_t nb = list->neighbors[i];
+                    if (!seen[nb]) {
+                        seen[nb] = true;
+                        order.push_back(nb);
                     }
                 }
             }
+        };
+        bfs_from(enter_point_id_.load(std::memory_order_relaxed));
+        for (uint32_t id : occupied) {
+            bfs_from(id);
         }
 
-        // ڵ 0 о
-        auto top_k = search_layer(query, curr_obj, std::max(k, ef_search), 0);
-        
-        ebr.exit_rcu_read();
-        
-        if (top_k.size() > (size_t)k) top_k.resize(k);
-        return top_k;
+        // 3.  id ->  id i ʵĽڵõ i Сռ id
+        std::vector<uint32_t> new_id(max_elements_);
+        for (size_t id = 0; id < max_elements_; ++id) new_id[id] = (uint32_t)id;
+        for (size_t i = 0; i < order.size(); ++i) new_id[order[i]] = occupied[i];
+
+        // 4. Ǩڵ͵ 0 ڵ飬ھ id ±
+        HnswNode* new_nodes = (HnswNode*)std::aligned_alloc(CACHE_LINE_SIZE, max_elements_ * sizeof(HnswNode));
+        char* new_blocks = (char*)permute_rows(level0_blocks_, level0_block_bytes_, new_id);
+        for (size_t old_id = 0; old_id < max_elements_; ++old_id) {
+            HnswNode& src = nodes_[old_id];
+            HnswNode* dst = new (&new_nodes[new_id[old_id]]) HnswNode();
+            dst->init(src.vector_data, src.level);
+            if (src.vector_data == nullptr) continue;
+            if (layout_ == NodeLayout::Colocated && storage_ == VectorStorage::Float32) {
+                dst->vector_data = reinterpret_cast<const float*>(new_blocks + (size_t)new_id[old_id] * level0_block_bytes_);
+            }
+            for (int level = 1; level <= src.level && level < MAX_HNSW_LEVELS; ++level) {
+                NeighborList* list = src.neighbor_lists[level].load(std::memory_order_relaxed);
+                if (list != nullptr) {
+                    for (uint32_t i = 0; i < list->count; ++i) list->neighbors[i] = new_id[list->neighbors[i]];
+                }
+                dst->neighbor_lists[level].store(list, std::memory_order_relaxed);
+            }
+        }
+        std::free(nodes_);
+        std::free(level0_blocks_);
+        nodes_ = new_nodes;
+        level0_blocks_ = new_blocks;
+        for (uint32_t id : occupied) {
+            NeighborList* list = level0_list(id);
+            for (uint32_t i = 0; i < list->count; ++i) list->neighbors[i] = new_id[list->neighbors[i]];
+        }
+
+        // 5. ְͬһûǨ
+        if (half_vectors_ != nullptr) {
+            if (layout_ == NodeLayout::Colocated) {
+                half_vectors_ = (uint16_t*)level0_blocks_;
+            } else {
+                replace_rows(half_vectors_, dim_ * sizeof(uint16_t), new_id);
+            }
+        }
+        replace_rows(inv_norms_, sizeof(float), new_id);
+        replace_rows(sq8_codes_, dim_, new_id);
+        replace_rows(pq_codes_, pq_.m, new_id);
+        replace_rows(bin_codes_, bin_.words * sizeof(uint64_t), new_id);
+        replace_rows(attr_tags_, sizeof(uint32_t), new_id);
+        replace_rows(attr_labels_, sizeof(uint64_t), new_id);
+        if (deleted_count_.load(std::memory_order_relaxed) > 0) {
+            AtomicBitset tombstones(max_elements_);
+            for (size_t old_id = 0; old_id < max_elements_; ++old_id) {
+                if (tombstones_.test(old_id)) tombstones.set(new_id[old_id]);
+            }
+            tombstones_ = std::move(tombstones);
+            for (uint32_t& id : pending_repair_) id = new_id[id];
+        }
+
+        // 6. ڵ id ӳ
+        enter_point_id_.store(new_id[enter_point_id_.load(std::memory_order_relaxed)], std::memory_order_relaxed);
+        if (to_external_.empty()) {
+            to_external_.resize(max_elements_);
+            for (size_t id = 0; id < max_elements_; ++id) to_external_[id] = (uint32_t)id;
+        }
+        std::vector<uint32_t> external(max_elements_);
+        for (size_t old_id = 0; old_id < max_elements_; ++old_id) external[new_id[old_id]] = to_external_[old_id];
+        to_external_.swap(external);
+        to_internal_.resize(max_elements_);
+        for (size_t id = 0; id < max_elements_; ++id) to_internal_[to_external_[id]] = (uint32_t)id;
+    }
+
+    // ÷ id ڲ id ĻתδŹʱͬ
+    // ÷ id ⲿinsert / ԶдԽֱ쳣ȥκΰ id 
+    inline uint32_t internal_id(uint32_t external) const {
+        if (external >= max_elements_) throw std::out_of_range("HnswIndex: id out of range");
+        return to_internal_.empty() ? external : to_internal_[external];
+    }
+    inline uint32_t external_id(uint32_t internal) const {
+        return to_external_.empty() ? internal : to_external_[internal];
     }
 
 private:
@@ -267,25 +1059,457 @@ private:
     int M_;
     int ef_construction_;
     double level_mult_;
+    MetricType metric_;
+    VectorStorage storage_;
+    DistanceFunc dist_func_; // ʱάȺ CPU ַõľں
+    BatchDistanceFunc batch_dist_func_; // һھõһԶں
+    float* inv_norms_;       // Ҷʹãÿڵ 1/||x||
+
+    uint16_t* half_vectors_; // FP16 / BF16 洢ʱеÿڵ dim_  uint16
+    size_t half_stride_;     // ڽڵ㸱֮ uint16 Separate Ϊ dim_Colocated ΪڵС
+    HalfDistanceFunc half_dist_func_;
+
+    ScalarQuantizer sq8_;
+    Sq8DistanceFunc sq8_dist_func_;
+    uint8_t* sq8_codes_;     // SQ8 ֣ÿڵ dim_ ֽڣѵŷ
+
+    ProductQuantizer pq_;
+    PqAdcDistanceFunc pq_dist_func_;
+    uint8_t* pq_codes_;      // PQ ֣ÿڵ pq_.m ֽڣѵŷ
+
+    BinaryQuantizer bin_;
+    uint64_t* bin_codes_;    // ֵ֣ÿڵ bin_.words  64 λ
+    HammingDistanceFunc bin_dist_func_;
+    uint32_t bin_slack_;     // Ԥɸſλ
+    bool use_binary_prefilter_;
+
+    TraversalCodec codec_;
+    size_t prefetch_distance_; // Ԥȡ룬0 ʾر
+    int visited_hash_max_ef_;
+    VisitedTablePool visited_pool_;
 
     HnswNode* nodes_; // ڴָ
 
+    // reorder_graph ֮ڲ id ÷ id ӳ䣬δʱΪգӳ䣩
+    std::vector<uint32_t> to_external_;
+    std::vector<uint32_t> to_internal_;
+
+    //  0 ڵ飺max_elements_ ţھӲֵĲ NeighborList ͬ
+    // ϲϡö࣬Ȼ HnswNode::neighbor_lists ϣneighbor_lists[0] ʹã
+    NodeLayout layout_;
+    size_t level0_block_bytes_;  // ÿڵֽ
+    size_t level0_links_offset_; // ھӱڿڵƫƣColocated λ֮
+    char* level0_blocks_;
+
     std::atomic<uint32_t> enter_point_id_;
     std::atomic<int> max_level_;
     std::mutex ep_mutex_; // ڱƵ max_level 
 
+    // ɾĹڲ id Ѱַpending_repair_ ѴĹûͼĽڵ
+    AtomicBitset tombstones_;
+    std::atomic<size_t> deleted_count_;
+    std::atomic<uint64_t> repaired_count_;
+    mutable std::mutex delete_mutex_; //  pending_repair_ Ĺλ / λ
+    std::mutex repair_mutex_;         // лͼִɾ id ²
+    std::vector<uint32_t> pending_repair_;
+
+    std::atomic<uint64_t> local_updates_;
+    std::atomic<uint64_t> relink_updates_;
+
+    // Уڲ id Ѱַ˲ѯ search_layer ھжǷԽ
+    uint32_t* attr_tags_;
+    uint64_t* attr_labels_;
+    FilterBitmapFunc filter_bitmap_func_; // ˻ɨʱȽϳλͼ
+
+    // һڵ㵽һڵľ루ʽüãҶֱȡ˻ķ
+    inline void distance_from_node(uint32_t node_id, const uint32_t* ids, size_t n, float* out) {
+        static thread_local std::vector<float> scratch;
+        scratch.resize(dim_);
+        distance_to_nodes(node_vector(node_id, scratch.data()),
+                          metric_ == MetricType::Cosine ? inv_norms_[node_id] : 1.0f, ids, n, out);
+    }
+
+    inline NeighborList* level0_list(uint32_t id) const {
+        return reinterpret_cast<NeighborList*>(level0_blocks_ + (size_t)id * level0_block_bytes_ + level0_links_offset_);
+    }
+
+    // ڵ level ھӱ 0 㰴 id ֱѰַϲ RCU ָ루Ϊգ
+    inline NeighborList* get_neighbors(uint32_t id, int level) const {
+        return level == 0 ? level0_list(id) : nodes_[id].get_neighbors_rcu(level);
+    }
+
+    // һһµھӱյ out 2M λھӸ
+    //  0  insert_bulk ϲɳдԭ޸ģڵ汾ţseqlockֶһ뱻ģض
+    // ʽ copy-on-write ϲɱ䣬汾Ųһζ
+    inline uint32_t read_neighbors(uint32_t id, int level, uint32_t* out) const {
+        const HnswNode& node = nodes_[id];
+        while (true) {
+            uint32_t version = node.version.load(std::memory_order_acquire);
+            if (version & 1) {
+                _mm_pause();
+                continue;
+            }
+            const NeighborList* list = get_neighbors(id, level);
+            uint32_t count = 0;
+            if (list != nullptr) {
+                count = std::min(list->count, list->capacity); // ˺ѵ count ҲԽ
+                std::memcpy(out, list->neighbors, count * sizeof(uint32_t));
+            }
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (node.version.load(std::memory_order_relaxed) == version) return count;
+        }
+    }
+
+    inline const uint16_t* half_vector(uint32_t id) const {
+        return half_vectors_ + (size_t)id * half_stride_;
+    }
+
+    // ڵ fp32 ͼFloat32 ֱӷõ뾫Ƚ뵽 scratchδĽڵ㷵 nullptr
+    // 뾫 HnswNode::vector_data ֻǽڵѲ룬뷵غٽ
+    const float* node_vector(uint32_t id, float* scratch) const {
+        const float* vec = nodes_[id].vector_data;
+        if (vec == nullptr || half_vectors_ == nullptr) return vec;
+        decode_half(storage_, half_vector(id), scratch, dim_);
+        return scratch;
+    }
+
+    // ½ڵдеĴ洢ؽڵӦõ fp32 ַ
+    inline const float* store_vector(const float* vec, uint32_t id) {
+        if (half_vectors_ != nullptr) {
+            encode_half(storage_, vec, half_vectors_ + (size_t)id * half_stride_, dim_);
+        } else if (layout_ == NodeLayout::Colocated) {
+            float* dst = reinterpret_cast<float*>(level0_blocks_ + (size_t)id * level0_block_bytes_);
+            std::memcpy(dst, vec, dim_ * sizeof(float));
+            return dst;
+        }
+        return vec;
+    }
+
+    inline uint8_t* sq8_code(uint32_t id) const {
+        return sq8_codes_ + (size_t)id * dim_;
+    }
+
+    inline uint8_t* pq_code(uint32_t id) const {
+        return pq_codes_ + (size_t)id * pq_.m;
+    }
+
+    inline uint64_t* bin_code(uint32_t id) const {
+        return bin_codes_ + (size_t)id * bin_.words;
+    }
+
+    //  new_id ûһÿ row_bytes ֽڵ飬·
+    void* permute_rows(const void* base, size_t row_bytes, const std::vector<uint32_t>& new_id) const {
+        char* dst = (char*)alloc_codes(row_bytes);
+        const char* src = (const char*)base;
+        for (size_t old_id = 0; old_id < max_elements_; ++old_id) {
+            std::memcpy(dst + (size_t)new_id[old_id] * row_bytes, src + old_id * row_bytes, row_bytes);
+        }
+        return dst;
+    }
+
+    // û滻һе飬δ
+    template <typename T>
+    void replace_rows(T*& base, size_t row_bytes, const std::vector<uint32_t>& new_id) {
+        if (base == nullptr) return;
+        T* permuted = (T*)permute_rows(base, row_bytes, new_id);
+        std::free(base);
+        base = permuted;
+    }
+
+    uint8_t* alloc_codes(size_t code_size) const {
+        size_t bytes = (max_elements_ * code_size + CACHE_LINE_SIZE - 1) / CACHE_LINE_SIZE * CACHE_LINE_SIZE;
+        return (uint8_t*)std::aligned_alloc(CACHE_LINE_SIZE, bytes);
+    }
+
+    // ѵڲʱ˳ֱ½ڵ
+    void encode_codes(const float* vec, uint32_t id) {
+        if (sq8_codes_ != nullptr) sq8_.encode(vec, sq8_code(id));
+        if (pq_codes_ != nullptr) pq_.encode(vec, pq_code(id));
+        if (bin_codes_ != nullptr) bin_.encode(vec, bin_code(id));
+    }
+
+    // ==========================================
+    // ѯsearch_layer / greedy_search_layer ģ̬ɣ
+    // ѭû麯ãҲ洢ʽ֧
+    // ==========================================
+    // ԭʼ float ֧ȫ
+    // kScreened Ϊ true ļṩ screen()search_layer ڽɸھ
+    struct FloatDistance {
+        static constexpr bool kScreened = false;
+        HnswIndex* index;
+        const float* query;
+        float inv_norm;
+
+        float operator()(uint32_t id) const { return index->distance_to_node(query, inv_norm, id); }
+        void batch(const uint32_t* ids, size_t n, float* out) const {
+            index->distance_to_nodes(query, inv_norm, ids, n, out);
+        }
+        void prefetch(uint32_t id) const { index->prefetch_vector(id); }
+    };
+
+    // SQ8 ֿ֣ռľ루 float L2 ȣֻ
+    struct Sq8Distance {
+        static constexpr bool kScreened = false;
+        HnswIndex* index;
+        const uint8_t* query_code;
+
+        float operator()(uint32_t id) const {
+            return (float)index->sq8_dist_func_(query_code, index->sq8_code(id), index->dim_);
+        }
+        void batch(const uint32_t* ids, size_t n, float* out) const {
+            size_t ahead = index->prefetch_distance_;
+            for (size_t i = 0; i < n; ++i) {
+                if (ahead > 0 && i + ahead < n) prefetch(ids[i + ahead]);
+                out[i] = (*this)(ids[i]);
+            }
+        }
+        void prefetch(uint32_t id) const { _mm_prefetch((const char*)index->sq8_code(id), _MM_HINT_T0); }
+    };
+
+    // PQ ֣ѯ ADC פ L1ǽ L2ֻ
+    struct PqDistance {
+        static constexpr bool kScreened = false;
+        HnswIndex* index;
+        const float* table;
+
+        float operator()(uint32_t id) const {
+            return index->pq_dist_func_(table, index->pq_code(id), index->pq_.m);
+        }
+        void batch(const uint32_t* ids, size_t n, float* out) const {
+            size_t ahead = index->prefetch_distance_;
+            for (size_t i = 0; i < n; ++i) {
+                if (ahead > 0 && i + ahead < n) prefetch(ids[i + ahead]);
+                out[i] = (*this)(ids[i]);
+            }
+        }
+        void prefetch(uint32_t id) const { _mm_prefetch((const char*)index->pq_code(id), _MM_HINT_T0); }
+    };
+
+    // float  + ֵԤɸ
+    struct BinaryScreenedDistance {
+        static constexpr bool kScreened = true;
+        FloatDistance base;
+        const uint64_t* query_code;
+        uint32_t slack;
+
+        float operator()(uint32_t id) const { return base(id); }
+        void batch(const uint32_t* ids, size_t n, float* out) const { base.batch(ids, n, out); }
+        // Ԥɸȶֵ֣ھһͱɸΪԤȡ float 
+        void prefetch(uint32_t id) const { _mm_prefetch((const char*)base.index->bin_code(id), _MM_HINT_T0); }
+
+        // ͵ѹ idsֻ벻"ĺ + slack"ھӣر
+        size_t screen(uint32_t* ids, size_t n, uint32_t worst_id) const {
+            HnswIndex* index = base.index;
+            size_t words = index->bin_.words;
+            uint32_t bound = index->bin_dist_func_(query_code, index->bin_code(worst_id), words) + slack;
+            size_t kept = 0;
+            for (size_t i = 0; i < n; ++i) {
+                if (index->bin_dist_func_(query_code, index->bin_code(ids[i]), words) <= bound) {
+                    ids[kept++] = ids[i];
+                }
+            }
+            return kept;
+        }
+    };
+
+    // δʽ SearchContext ĵʹ߳˽еĬ
+    static SearchContext& local_context() {
+        static thread_local SearchContext ctx;
+        return ctx;
+    }
+
+    // ߲̰½ 0 㣬ڵ 0  ef ȵľѣ ctx.results()
+    // ϲ½ֻΪһõ㣬ֵͬ search_layer
+    template <typename Dist>
+    bool search_from_top(const Dist& dist, uint32_t ep_id, int top_level, int ef, SearchContext& ctx,
+                         const AttributeFilter* filter = nullptr) {
+        uint32_t curr_obj = ep_id;
+        float curr_dist = dist(curr_obj);
+        for (int level = top_level; level >= 1; --level) {
+            greedy_search_layer(dist, curr_obj, curr_dist, level, ctx);
+        }
+        return search_layer(dist, curr_obj, ef, 0, ctx, filter);
+    }
+
+    // ܿʱĻˣλͼںɨһУֻѲδɾĽڵ float 룬
+    // Ǿȷ top-kÿڵ 12 ֽڣɨ˳ͼĿĵ߱˵ö
+    void filtered_scan(const FloatDistance& dist, int k, SearchContext& ctx, const AttributeFilter& filter) {
+        static thread_local std::vector<uint64_t> match;
+        size_t words = AtomicBitset::word_count(max_elements_);
+        match.resize(words);
+        uint32_t tag_mask = filter.tag_mask();
+        filter_bitmap_func_(attr_tags_, attr_labels_, max_elements_, filter.tag & tag_mask, tag_mask,
+                            filter.all_labels, filter.any_labels, match.data());
+        bool has_deleted = deleted_count_.load(std::memory_order_relaxed) > 0;
+
+        ctx.reset_heaps(k);
+        uint32_t ids[kBatchSize];
+        float dists[kBatchSize];
+        size_t n = 0;
+        auto score = [&]() {
+            dist.batch(ids, n, dists);
+            for (size_t i = 0; i < n; ++i) {
+                if (ctx.top_size() < (size_t)k || dists[i] < ctx.top_worst().dist) {
+                    ctx.push_top({ids[i], dists[i]});
+                    if (ctx.top_size() > (size_t)k) ctx.pop_top();
+                }
+            }
+            n = 0;
+        };
+        for (size_t w = 0; w < words; ++w) {
+            uint64_t bits = match[w];
+            if (has_deleted) bits &= ~tombstones_.word(w);
+            while (bits != 0) {
+                uint32_t id = (uint32_t)(w * 64 + (size_t)__builtin_ctzll(bits));
+                bits &= bits - 1;
+                if (nodes_[id].vector_data == nullptr) continue;
+                ids[n++] = id;
+                if (n == kBatchSize) score();
+            }
+        }
+        if (n > 0) score();
+        ctx.sort_top_into_results();
+        stable_top_k(dist, ctx, k);
+    }
+
+    // float ĽѾ float 룬;дʱڵ update_existing ԭظд
+    // 뾫ȡColocated ͵д¾ɻϵصǰ k 󰴰汾У´֣
+    // ظ÷ľһӦĳ汾ֻ k ξ
+    void stable_top_k(const FloatDistance& dist, SearchContext& ctx, int k) {
+        std::vector<NodeDist>& results = ctx.results();
+        if (results.size() > (size_t)k) results.resize(k);
+        rerank(dist, ctx, k);
+    }
+
+    //  float  ctx.results() ĺѡ´򣬱ǰ k 
+    void rerank(const FloatDistance& dist, SearchContext& ctx, int k) {
+        std::vector<NodeDist>& scored = ctx.results();
+        std::vector<uint32_t>& ids = ctx.ids();
+        std::vector<float>& dists = ctx.dists();
+        ids.resize(scored.size());
+        dists.resize(scored.size());
+        for (size_t i = 0; i < scored.size(); ++i) {
+            ids[i] = scored[i].id;
+        }
+        // ǰһνڵ汾ţupdate_existing ԭظдڼ䱻дĽڵ㵥
+        static thread_local std::vector<uint32_t> versions;
+        versions.resize(scored.size());
+        for (size_t i = 0; i < scored.size(); ++i) {
+            versions[i] = nodes_[ids[i]].version.load(std::memory_order_acquire);
+        }
+        dist.batch(ids.data(), ids.size(), dists.data());
+        std::atomic_thread_fence(std::memory_order_acquire);
+        for (size_t i = 0; i < scored.size(); ++i) {
+            const HnswNode& node = nodes_[ids[i]];
+            uint32_t version = versions[i];
+            while ((version & 1) || node.version.load(std::memory_order_relaxed) != version) {
+                version = node.version.load(std::memory_order_acquire);
+                if (version & 1) {
+                    _mm_pause();
+                    continue;
+                }
+                dists[i] = dist(ids[i]);
+                std::atomic_thread_fence(std::memory_order_acquire);
+            }
+            scored[i].dist = dists[i];
+        }
+        ids.clear();
+        size_t top = std::min(scored.size(), (size_t)k);
+        std::partial_sort(scored.begin(), scored.begin() + top, scored.end(),
+                          [](const NodeDist& a, const NodeDist& b) { return a.dist < b.dist; });
+        scored.resize(top);
+    }
+
+    // ԤȡڵǰСSeparate + Float32 ַҪȶ HnswNode ֪
+    // ֻԤȡڵ¼뾫Ⱥ Colocated µַ id ֱ
+    inline void prefetch_vector(uint32_t id) const {
+        const char* p;
+        size_t bytes;
+        if (half_vectors_ != nullptr) {
+            p = (const char*)half_vector(id);
+            bytes = dim_ * sizeof(uint16_t);
+        } else if (layout_ == NodeLayout::Colocated) {
+            p = level0_blocks_ + (size_t)id * level0_block_bytes_;
+            bytes = dim_ * sizeof(float);
+        } else {
+            _mm_prefetch((const char*)&nodes_[id], _MM_HINT_T0);
+            return;
+        }
+        bytes = std::min(bytes, kPrefetchVectorLines * CACHE_LINE_SIZE);
+        for (size_t off = 0; off < bytes; off += CACHE_LINE_SIZE) {
+            _mm_prefetch(p + off, _MM_HINT_T0);
+        }
+    }
+
+    // Ԥȡڵ level ھӱ 0 㰴 id ֱַϲֻԤȡűָĽڵ¼
+    inline void prefetch_neighbors(uint32_t id, int level) const {
+        if (level == 0) {
+            const char* p = (const char*)level0_list(id);
+            size_t bytes = (2 + 2 * (size_t)M_) * sizeof(uint32_t);
+            for (size_t off = 0; off < bytes; off += CACHE_LINE_SIZE) {
+                _mm_prefetch(p + off, _MM_HINT_T0);
+            }
+        } else {
+            _mm_prefetch((const char*)&nodes_[id].neighbor_lists[level], _MM_HINT_T0);
+        }
+    }
+
+    // ϲ̰½ level 㲻ѯھӣֱ޷Ľ
+    template <typename Dist>
+    void greedy_search_layer(const Dist& dist, uint32_t& curr_obj, float& curr_dist, int level, SearchContext& ctx) {
+        uint32_t* snapshot = ctx.neighbor_snapshot(2 * (size_t)M_);
+        uint32_t ids[kBatchSize];
+        float dists[kBatchSize];
+        bool changed = true;
+        while (changed) {
+            changed = false;
+            uint32_t count = read_neighbors(curr_obj, level, snapshot);
+
+            for (uint32_t start = 0; start < count; start += kBatchSize) {
+                size_t n = std::min<size_t>(kBatchSize, count - start);
+                std::memcpy(ids, snapshot + start, n * sizeof(uint32_t));
+                if (prefetch_distance_ > 0) {
+                    for (size_t i = 0; i < std::min(n, prefetch_distance_); ++i) dist.prefetch(ids[i]);
+                }
+                dist.batch(ids, n, dists);
+                for (size_t i = 0; i < n; ++i) {
+                    if (dists[i] < curr_dist) {
+                        curr_dist = dists[i];
+                        curr_obj = ids[i];
+                        changed = true;
+                    }
+                }
+                // µһҪչĽڵ㣬ǰھӱ
+                if (changed && prefetch_distance_ > 0) prefetch_neighbors(curr_obj, level);
+            }
+        }
+    }
+
+    // ʱ½ڵ 1/||x||ظβ
+    inline float init_inv_norm(const float* vector_data, uint32_t id) {
+        if (metric_ != MetricType::Cosine) return 1.0f;
+        inv_norms_[id] = compute_inv_norm(vector_data, dim_);
+        return inv_norms_[id];
+    }
+
+    // ÷ node  node_lockѴĹĽڵ㲻ٽ±ߣ֮ھӲűɾͼѾɨ
+    // node £Ҫдȥͻָһ clear_neighbors յĽڵ㣬Ҳûޡ
+    // Ĺͼʼǰϣͼ node_lock  node ıڼһܿ
     inline void add_neighbor_inplace(HnswNode* node, int layer, uint32_t new_neighbor_id, int max_m) {
         if (layer >= MAX_HNSW_LEVELS) return;
+        if (tombstones_.test(new_neighbor_id)) return;
+        uint32_t node_id = (uint32_t)(node - nodes_);
 
-        NeighborList* list = node->neighbor_lists[layer].load(std::memory_order_relaxed); 
-        
-        //  1һ䣬 1 λ
-        if (list == nullptr) {
-            size_t alloc_size = sizeof(NeighborList) + (max_m + 1) * sizeof(uint32_t);
-            list = (NeighborList*)std::malloc(alloc_size); 
-            list->capacity = max_m + 1;
-            list->count = 0;
-            node->neighbor_lists[layer].store(list, std::memory_order_release);
+        NeighborList* list;
+        if (layer == 0) {
+            list = level0_list(node_id);
+        } else {
+            list = node->neighbor_lists[layer].load(std::memory_order_relaxed);
+            //  1һ䡿 slab ȡһ max_m ı
+            if (list == nullptr) {
+                list = NeighborListPool::get_instance().allocate((uint32_t)max_m);
+                node->neighbor_lists[layer].store(list, std::memory_order_release);
+            }
         }
 
         // ȥط
@@ -293,60 +1517,377 @@ private:
             if (list->neighbors[i] == new_neighbor_id) return;
         }
 
-        // ȥ
-        list->neighbors[list->count++] = new_neighbor_id;
+        // пղλֱ׷
+        if (list->count < (uint32_t)max_m) {
+            node->begin_write();
+            list->neighbors[list->count++] = new_neighbor_id;
+            node->end_write();
+            return;
+        }
 
         // ޸ HNSW ʽü
-        if (list->count > max_m) {
-            std::vector<std::pair<float, uint32_t>> candidates;
-            candidates.reserve(list->count);
-            for (size_t i = 0; i < list->count; ++i) {
-                uint32_t cand_id = list->neighbors[i];
-                //  Index ڲֱӵ get_node  dim_ûκ谭
-                float dist = l2_distance_avx2(node->vector_data, get_node(cand_id)->vector_data, dim_);
-                candidates.push_back({dist, cand_id});
+        // λھӼھΪѡʱѡãдزλʱŽд䣬
+        // ֻһСοڼ
+        static thread_local std::vector<uint32_t> cand_ids;
+        static thread_local std::vector<uint32_t> selected;
+        cand_ids.assign(list->neighbors, list->neighbors + list->count);
+        cand_ids.push_back(new_neighbor_id);
+        selected.resize(max_m);
+        uint32_t count = select_neighbors_heuristic(node_id, cand_ids.data(), cand_ids.size(), max_m, selected.data());
+        node->begin_write();
+        std::memcpy(list->neighbors, selected.data(), count * sizeof(uint32_t));
+        list->count = count;
+        node->end_write();
+    }
+
+    // ϲھӱʽд루copy-on-write new_ids  node  layer ھӱ
+    //  max_m ʱ add_neighbor_inplace ͬʽü±úһԷ
+    // ߿ҪôľɱҪô±ڵлͬһڵдߣ
+    // ɱ EBR ںص NeighborListPool á÷봦 RCU ٽ
+    void add_neighbors_cow(HnswNode* node, int layer, const uint32_t* new_ids, size_t n, int max_m) {
+        if (layer >= MAX_HNSW_LEVELS) return;
+        uint32_t node_id = (uint32_t)(node - nodes_);
+        NeighborListPool& list_pool = NeighborListPool::get_instance();
+        NeighborList* new_list = list_pool.allocate((uint32_t)max_m); // ȡ±
+
+        static thread_local std::vector<uint32_t> cand_ids;
+        node->node_lock.lock();
+        NeighborList* old_list = node->neighbor_lists[layer].load(std::memory_order_relaxed);
+        cand_ids.clear();
+        if (old_list != nullptr) {
+            cand_ids.assign(old_list->neighbors, old_list->neighbors + old_list->count);
+        }
+        size_t old_count = cand_ids.size();
+        for (size_t i = 0; i < n; ++i) {
+            if (tombstones_.test(new_ids[i])) continue; // ͬ add_neighbor_inplaceɾĽڵ㲻±
+            if (std::find(cand_ids.begin(), cand_ids.end(), new_ids[i]) == cand_ids.end()) {
+                cand_ids.push_back(new_ids[i]);
             }
+        }
 
-            std::sort(candidates.begin(), candidates.end());
+        // ȫеıߣ±δֱӻ
+        if (cand_ids.size() == old_count) {
+            node->node_lock.unlock();
+            list_pool.recycle(new_list);
+            return;
+        }
 
-            list->count = 0; 
-            for (const auto& cand : candidates) {
-                if (list->count >= max_m) break;
-
-                bool keep = true;
-                for (size_t i = 0; i < list->count; ++i) {
-                    uint32_t selected_id = list->neighbors[i];
-                    float dist_to_selected = l2_distance_avx2(
-                        get_node(cand.second)->vector_data,
-                        get_node(selected_id)->vector_data,
-                        dim_
-                    );
-                    // ʽѡھӸ
-                    if (dist_to_selected < cand.first) {
-                        keep = false;
+        if (cand_ids.size() <= (size_t)max_m) {
+            std::memcpy(new_list->neighbors, cand_ids.data(), cand_ids.size() * sizeof(uint32_t));
+            new_list->count = (uint32_t)cand_ids.size();
+        } else {
+            new_list->count = select_neighbors_heuristic(node_id, cand_ids.data(), cand_ids.size(), max_m,
+                                                         new_list->neighbors);
+        }
+        node->neighbor_lists[layer].store(new_list, std::memory_order_release);
+        node->node_lock.unlock();
+
+        if (old_list != nullptr) {
+            EBRManager::get_instance().defer_delete(old_list, &NeighborListPool::recycle_deleter);
+        }
+    }
+
+    //  id  level ָɾڵı߸ĽӵɾڵĴھϣûıʱֻд
+    // ÷ RCU ٽ
+    void repair_neighbors(uint32_t id, int level) {
+        static thread_local std::vector<uint32_t> snapshot;
+        static thread_local std::vector<uint32_t> candidates;
+        static thread_local std::vector<uint32_t> selected;
+        snapshot.resize(2 * (size_t)M_);
+        uint32_t count = read_neighbors(id, level, snapshot.data());
+        bool dirty = false;
+        for (uint32_t i = 0; i < count && !dirty; ++i) {
+            dirty = tombstones_.test(snapshot[i]);
+        }
+        if (!dirty) return;
+
+        // ¶֮߳̿ѾĹ
+        HnswNode* node = get_node(id);
+        node->node_lock.lock();
+        const NeighborList* list = get_neighbors(id, level);
+        candidates.clear();
+        auto add_candidate = [&](uint32_t v) {
+            if (v != id && !tombstones_.test(v) && std::find(candidates.begin(), candidates.end(), v) == candidates.end()) {
+                candidates.push_back(v);
+            }
+        };
+        for (uint32_t i = 0; list != nullptr && i < list->count; ++i) {
+            uint32_t v = list->neighbors[i];
+            if (!tombstones_.test(v)) {
+                add_candidate(v);
+                continue;
+            }
+            uint32_t n = read_neighbors(v, level, snapshot.data());
+            for (uint32_t j = 0; j < n; ++j) add_candidate(snapshot[j]);
+        }
+
+        int max_m = level == 0 ? 2 * M_ : M_;
+        selected.resize(max_m);
+        uint32_t num;
+        if (candidates.size() <= (size_t)max_m) {
+            num = (uint32_t)candidates.size();
+            std::copy(candidates.begin(), candidates.end(), selected.begin());
+        } else {
+            num = select_neighbors_heuristic(id, candidates.data(), candidates.size(), max_m, selected.data());
+        }
+
+        replace_neighbors(id, level, selected.data(), num);
+        node->node_lock.unlock();
+    }
+
+    // ÷ id  node_lock滻 id  level ھӡ 0 ԭظд汾ű
+    // ϲ copy-on-write ±ɱ EBRںص slab
+    void replace_neighbors(uint32_t id, int level, const uint32_t* ids, uint32_t n) {
+        HnswNode* node = get_node(id);
+        if (level == 0) {
+            NeighborList* level0 = level0_list(id);
+            node->begin_write();
+            std::memcpy(level0->neighbors, ids, n * sizeof(uint32_t));
+            level0->count = n;
+            node->end_write();
+            return;
+        }
+        NeighborList* new_list = NeighborListPool::get_instance().allocate((uint32_t)M_);
+        std::memcpy(new_list->neighbors, ids, n * sizeof(uint32_t));
+        new_list->count = n;
+        NeighborList* old_list = node->neighbor_lists[level].exchange(new_list, std::memory_order_acq_rel);
+        if (old_list != nullptr) {
+            EBRManager::get_instance().defer_delete(old_list, &NeighborListPool::recycle_deleter);
+        }
+    }
+
+    // Ѵڽڵ¡ھڣľ벻Զĵ 0 ھӣʱ
+    // ֲˢ£ÿӽڵһ M ȵ search_layerھӺϲʽѡ
+    // ֻѡеھӲߣһβļ֮һƯƸʱȰԼӾھӵıժ
+    // һߡڵڵָı
+    void update_existing(const float* vector_data, uint32_t id, SearchContext& ctx) {
+        static thread_local std::vector<uint32_t> neighbors;
+        static thread_local std::vector<float> dists;
+        auto& ebr = EBRManager::get_instance();
+        ebr.enter_rcu_read();
+        HnswNode* node = get_node(id);
+        float inv_norm = metric_ == MetricType::Cosine ? compute_inv_norm(vector_data, dim_) : 1.0f;
+        FloatDistance new_dist{this, vector_data, inv_norm};
+
+        // 1. Ưƺ;뾶д֮ǰ
+        neighbors.resize(2 * (size_t)M_);
+        uint32_t count = read_neighbors(id, 0, neighbors.data());
+        dists.resize(count);
+        distance_from_node(id, neighbors.data(), count, dists.data());
+        float radius = count > 0 ? *std::max_element(dists.begin(), dists.end()) : 0.0f;
+        bool local = count > 0 && new_dist(id) <= radius;
+
+        // 2. д֡뾫ȡColocated ֶԭظдŽڵд䣺
+        //    search_knn_scored ÿ·ǰ汾У´֣rerank / stable_top_k
+        //    һ뱻ĵĽڵ㣻;еĴݿ¾ɻϵֻӰһ򣬲Խ
+        node->begin_write();
+        node->vector_data = store_vector(vector_data, id);
+        init_inv_norm(vector_data, id);
+        encode_codes(vector_data, id);
+        node->end_write();
+
+        // 3. 
+        int top_level = std::min(node->level, max_level_.load(std::memory_order_acquire));
+        if (local) {
+            for (int level = top_level; level >= 0; --level) {
+                search_layer(new_dist, id, M_, level, ctx);
+                relink(id, level, ctx.results());
+            }
+            local_updates_.fetch_add(1, std::memory_order_relaxed);
+        } else {
+            for (int level = top_level; level >= 0; --level) {
+                count = read_neighbors(id, level, neighbors.data());
+                for (uint32_t i = 0; i < count; ++i) remove_neighbor(neighbors[i], level, id);
+            }
+            uint32_t curr_obj = enter_point_id_.load(std::memory_order_acquire);
+            float curr_dist = new_dist(curr_obj);
+            for (int level = max_level_.load(std::memory_order_acquire); level > top_level; --level) {
+                greedy_search_layer(new_dist, curr_obj, curr_dist, level, ctx);
+            }
+            for (int level = top_level; level >= 0; --level) {
+                search_layer(new_dist, curr_obj, ef_construction_, level, ctx);
+                relink(id, level, ctx.results());
+                for (const NodeDist& nd : ctx.results()) {
+                    if (nd.id != id) {
+                        curr_obj = nd.id;
                         break;
                     }
                 }
+            }
+            relink_updates_.fetch_add(1, std::memory_order_relaxed);
+        }
+        ebr.exit_rcu_read();
+    }
 
-                if (keep) {
-                    list->neighbors[list->count++] = cand.second;
+    //  id  level еĴھ  found ΪѡʽѡھӱٸѡеھӲߡ
+    // ÷ RCU ٽ
+    void relink(uint32_t id, int level, const std::vector<NodeDist>& found) {
+        static thread_local std::vector<uint32_t> previous;
+        static thread_local std::vector<uint32_t> candidates;
+        static thread_local std::vector<uint32_t> selected;
+        int max_m = level == 0 ? 2 * M_ : M_;
+        HnswNode* node = get_node(id);
+        node->node_lock.lock();
+        const NeighborList* list = get_neighbors(id, level);
+        previous.clear();
+        if (list != nullptr) previous.assign(list->neighbors, list->neighbors + list->count);
+        candidates.clear();
+        for (uint32_t v : previous) {
+            if (!tombstones_.test(v)) candidates.push_back(v);
+        }
+        for (const NodeDist& nd : found) {
+            if (nd.id != id && !tombstones_.test(nd.id) &&
+                std::find(candidates.begin(), candidates.end(), nd.id) == candidates.end()) {
+                candidates.push_back(nd.id);
+            }
+        }
+        selected.resize(max_m);
+        uint32_t num;
+        if (candidates.size() <= (size_t)max_m) {
+            num = (uint32_t)candidates.size();
+            std::copy(candidates.begin(), candidates.end(), selected.begin());
+        } else {
+            num = select_neighbors_heuristic(id, candidates.data(), candidates.size(), max_m, selected.data());
+        }
+        replace_neighbors(id, level, selected.data(), num);
+        node->node_lock.unlock();
+
+        for (uint32_t i = 0; i < num; ++i) {
+            uint32_t v = selected[i];
+            if (std::find(previous.begin(), previous.end(), v) != previous.end()) continue;
+            if (level == 0) {
+                HnswNode* neighbor_node = get_node(v);
+                neighbor_node->node_lock.lock();
+                add_neighbor_inplace(neighbor_node, 0, id, max_m);
+                neighbor_node->node_lock.unlock();
+            } else {
+                add_neighbors_cow(get_node(v), level, &id, 1, max_m);
+            }
+        }
+    }
+
+    //  target  id  level ھӱժʱʲô
+    void remove_neighbor(uint32_t id, int level, uint32_t target) {
+        static thread_local std::vector<uint32_t> kept;
+        HnswNode* node = get_node(id);
+        node->node_lock.lock();
+        const NeighborList* list = get_neighbors(id, level);
+        if (list != nullptr && std::find(list->neighbors, list->neighbors + list->count, target) != list->neighbors + list->count) {
+            kept.clear();
+            for (uint32_t i = 0; i < list->count; ++i) {
+                if (list->neighbors[i] != target) kept.push_back(list->neighbors[i]);
+            }
+            replace_neighbors(id, level, kept.data(), (uint32_t)kept.size());
+        }
+        node->node_lock.unlock();
+    }
+
+    // սڵĸھӱ 0 ԭ㣬ϲժº󽻸 EBRںص slab
+    void clear_neighbors(uint32_t id) {
+        HnswNode* node = get_node(id);
+        node->node_lock.lock();
+        node->begin_write();
+        level0_list(id)->count = 0;
+        node->end_write();
+        for (int level = 1; level < MAX_HNSW_LEVELS; ++level) {
+            NeighborList* list = node->neighbor_lists[level].exchange(nullptr, std::memory_order_acq_rel);
+            if (list != nullptr) {
+                EBRManager::get_instance().defer_delete(list, &NeighborListPool::recycle_deleter);
+            }
+        }
+        node->node_lock.unlock();
+    }
+
+    // ɾ id ²룺Ƚеͼ޸¼Ĺھӱ clear_neighbors ա
+    // ڵָıߣû޵ԭָľǼ
+    void revive(uint32_t id) {
+        std::lock_guard<std::mutex> repair_lock(repair_mutex_);
+        std::lock_guard<std::mutex> lock(delete_mutex_);
+        if (!tombstones_.test(id)) return;
+        pending_repair_.erase(std::remove(pending_repair_.begin(), pending_repair_.end(), id), pending_repair_.end());
+        clear_neighbors(id);
+        tombstones_.reset(id);
+        deleted_count_.fetch_sub(1, std::memory_order_relaxed);
+    }
+
+    // ڱɾʱɲߵĴڵ㣨Ҫɨһȫڵ㣬ֻڱɾʱȫɾʱͼص
+    void replace_deleted_enter_point() {
+        uint32_t old_ep = enter_point_id_.load(std::memory_order_acquire);
+        if (max_level_.load(std::memory_order_acquire) == -1 || !tombstones_.test(old_ep)) return;
+        int best_level = -1;
+        uint32_t best = 0;
+        for (size_t i = 0; i < max_elements_; ++i) {
+            const HnswNode& node = nodes_[i];
+            if (node.vector_data != nullptr && !tombstones_.test(i) && node.level > best_level) {
+                best_level = node.level;
+                best = (uint32_t)i;
+            }
+        }
+        std::lock_guard<std::mutex> lock(ep_mutex_);
+        if (enter_point_id_.load(std::memory_order_acquire) != old_ep) return; // ڼи߲½ڵ
+        enter_point_id_.store(best, std::memory_order_release);
+        max_level_.store(best_level, std::memory_order_release);
+    }
+
+    // HNSW ʽѡڣѡ node_id ľɽԶĳѡھӱ node_id ĺѡ
+    // ֤ھӷ max_m ʱٰ벹롣д outظ
+    // out  cand_ids ص
+    uint32_t select_neighbors_heuristic(uint32_t node_id, const uint32_t* cand_ids, size_t cand_count,
+                                        int max_m, uint32_t* out) {
+        static thread_local std::vector<float> dists;
+        static thread_local std::vector<std::pair<float, uint32_t>> candidates;
+
+        // ڵ㵽ȫѡľһ
+        dists.resize(cand_count);
+        distance_from_node(node_id, cand_ids, cand_count, dists.data());
+
+        candidates.clear();
+        for (size_t i = 0; i < cand_count; ++i) {
+            candidates.push_back({dists[i], cand_ids[i]});
+        }
+
+        std::sort(candidates.begin(), candidates.end());
+
+        uint32_t count = 0;
+        for (const auto& cand : candidates) {
+            if (count >= (uint32_t)max_m) break;
+
+            // ѡѡھӵľͬ
+            distance_from_node(cand.second, out, count, dists.data());
+            bool keep = true;
+            for (size_t i = 0; i < count; ++i) {
+                // ʽѡھӸ
+                if (dists[i] < cand.first) {
+                    keep = false;
+                    break;
                 }
             }
 
-            // ײ
-            if (list->count < max_m) {
-                for (const auto& cand : candidates) {
-                    if (list->count >= max_m) break;
-                    bool exists = false;
-                    for (size_t i = 0; i < list->count; ++i) {
-                        if (list->neighbors[i] == cand.second) { exists = true; break; }
-                    }
-                    if (!exists) {
-                        list->neighbors[list->count++] = cand.second;
-                    }
+            if (keep) {
+                out[count++] = cand.second;
+            }
+        }
+
+        // ײ
+        if (count < (uint32_t)max_m) {
+            for (const auto& cand : candidates) {
+                if (count >= (uint32_t)max_m) break;
+                bool exists = false;
+                for (size_t i = 0; i < count; ++i) {
+                    if (out[i] == cand.second) { exists = true; break; }
+                }
+                if (!exists) {
+                    out[count++] = cand.second;
                 }
             }
         }
+        return count;
+    }
+
+    // ڵܷѣɾԲĲ
+    inline bool excluded(uint32_t id, bool has_deleted, const AttributeFilter* filter) const {
+        return (has_deleted && tombstones_.test(id)) ||
+               (filter != nullptr && !filter->matches(attr_tags_[id], attr_labels_[id]));
     }
 
     //  (̰߳ȫ)
@@ -357,75 +1898,88 @@ private:
         return std::min((int)r, MAX_HNSW_LEVELS - 1);
     }
 
-    // ķʱǼ (thread_local ϶̲߳ͼ/ѯ)
-    bool is_visited(uint32_t id) {
-        static thread_local std::vector<uint32_t> visited_array;
-        static thread_local uint32_t current_version = 0;
-        
-        if (visited_array.size() <= id) visited_array.resize(max_elements_, 0);
-        
-        if (id == 0xFFFFFFFF) { // ǣð汾
-           current_version++;
-           if (current_version == 0) { 
-               std::fill(visited_array.begin(), visited_array.end(), 0);
-               current_version = 1;
-           }
-           return true;
-        }
+    // ͨõĵʽѡѡѺ visited  ctx ģ
+    // ɽԶд ctx.results()ɾĽڵ㡢Լ filter ǿʱԲĽڵ
+    // ճѡѡչѡfilter ǿʱչ ef * kFilteredExpansionFactor ѡ
+    // Ԥʱѻû ef  falseɿ򷵻 true
+    template <typename Dist>
+    bool search_layer(const Dist& dist, uint32_t ep_id, int ef, int level, SearchContext& ctx,
+                      const AttributeFilter* filter = nullptr) {
+        float ep_dist = dist(ep_id);
+        bool has_deleted = deleted_count_.load(std::memory_order_relaxed) > 0;
 
-        if (visited_array[id] == current_version) return true;
-        visited_array[id] = current_version;
-        return false;
-    }
+        // ԤƷÿչһѡ 2M ھӣչ ef ͬ
+        ctx.begin_visit(visited_pool_, (size_t)ef * 2 * M_, ef <= visited_hash_max_ef_);
+        ctx.reset_heaps(ef);
+        uint32_t* snapshot = ctx.neighbor_snapshot(2 * (size_t)M_);
+        uint32_t ids[kBatchSize];
+        float dists[kBatchSize];
+        ctx.test_and_visit(ep_id);
 
-    // ͨõĵʽ
-    std::vector<uint32_t> search_layer(const float* query, uint32_t ep_id, int ef, int level) {
-        std::priority_queue<NodeDist> top_candidates;
-        std::priority_queue<NodeDist, std::vector<NodeDist>, std::greater<NodeDist>> candidates;
+        ctx.push_candidate({ep_id, ep_dist});
+        if (!excluded(ep_id, has_deleted, filter)) ctx.push_top({ep_id, ep_dist});
 
-        float ep_dist = l2_distance_avx2(query, get_node(ep_id)->vector_data, dim_);
-        
-        is_visited(0xFFFFFFFF); //  visited
-        is_visited(ep_id);
+        size_t budget = filter != nullptr ? (size_t)ef * kFilteredExpansionFactor
+                                         : std::numeric_limits<size_t>::max();
+        bool complete = true;
+        while (!ctx.candidates_empty()) {
+            NodeDist current = ctx.candidates_top();
+            ctx.pop_candidate();
 
-        candidates.push({ep_id, ep_dist});
-        top_candidates.push({ep_id, ep_dist});
+            if (ctx.top_size() == (size_t)ef && current.dist > ctx.top_worst().dist) {
+                break; 
+            }
+            if (budget-- == 0) {
+                // ԤʱֹͣͿЧˣãû˵Ľڵ̫ϡ
+                complete = ctx.top_size() == (size_t)ef;
+                break;
+            }
 
-        while (!candidates.empty()) {
-            NodeDist current = candidates.top();
-            candidates.pop();
+            uint32_t count = read_neighbors(current.id, level, snapshot);
+            if (count == 0) continue;
 
-            if (current.dist > top_candidates.top().dist && top_candidates.size() == (size_t)ef) {
-                break; 
+            // һѡھӱڱڼ
+            if (prefetch_distance_ > 0 && !ctx.candidates_empty()) {
+                prefetch_neighbors(ctx.candidates_top().id, level);
             }
 
-            NeighborList* neighbors = get_node(current.id)->get_neighbors_rcu(level);
-            if (!neighbors) continue;
+            // ռδʵھӣһ֣
+            // ռͬʱΪǰ prefetch_distance_ δھӷԤȡ visited ص
+            for (uint32_t start = 0; start < count; start += kBatchSize) {
+                uint32_t end = std::min<uint32_t>(count, start + (uint32_t)kBatchSize);
+                size_t n = 0;
+                for (uint32_t i = start; i < end; ++i) {
+                    uint32_t neighbor_id = snapshot[i];
+                    if (!ctx.test_and_visit(neighbor_id)) {
+                        if (n < prefetch_distance_) dist.prefetch(neighbor_id);
+                        ids[n++] = neighbor_id;
+                    }
+                }
+                if constexpr (Dist::kScreened) {
+                    if (ctx.top_size() == (size_t)ef) {
+                        n = dist.screen(ids, n, ctx.top_worst().id);
+                    }
+                }
+                if (n == 0) continue;
+                dist.batch(ids, n, dists);
 
-            for (uint32_t i = 0; i < neighbors->count; ++i) {
-                uint32_t neighbor_id = neighbors->neighbors[i];
-                if (!is_visited(neighbor_id)) {
-                    float d = l2_distance_avx2(query, get_node(neighbor_id)->vector_data, dim_);
-                    
-                    if (top_candidates.size() < (size_t)ef || d < top_candidates.top().dist) {
-                        candidates.push({neighbor_id, d});
-                        top_candidates.push({neighbor_id, d});
-                        if (top_candidates.size() > (size_t)ef) {
-                            top_candidates.pop();
+                for (size_t i = 0; i < n; ++i) {
+                    float d = dists[i];
+                    if (ctx.top_size() < (size_t)ef || d < ctx.top_worst().dist) {
+                        ctx.push_candidate({ids[i], d});
+                        if (excluded(ids[i], has_deleted, filter)) continue;
+                        ctx.push_top({ids[i], d});
+                        if (ctx.top_size() > (size_t)ef) {
+                            ctx.pop_top();
                         }
                     }
                 }
             }
         }
 
-        std::vector<uint32_t> result;
-        result.reserve(top_candidates.size());
-        while (!top_candidates.empty()) {
-            result.push_back(top_candidates.top().id);
-            top_candidates.pop();
-        }
-        std::reverse(result.begin(), result.end()); // ɽԶ
-        return result;
+        ctx.end_visit(visited_pool_);
+        ctx.sort_top_into_results(); // ɽԶ
+        return complete;
     }
 };
 
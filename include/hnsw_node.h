@@ -3,6 +3,7 @@
 #include <cstdint>
 #include <cstdlib>
 #include <cstring>
+#include <immintrin.h>
 #include "ebr_manager.h" // ޸ EBR 
 
 namespace vector_search {
@@ -43,6 +44,19 @@ struct alignas(CACHE_LINE_SIZE) HnswNode {
     int level; // ýڵڵ߲
     SpinLock node_lock; // ڵ״̬
 
+    // ھӱ汾ţseqlockԭ޸ǰһʾдڸġ
+    // ڿھǰһΣһ¾ضֻг node_lock д߲ܵ begin_write / end_write
+    std::atomic<uint32_t> version{0};
+
+    inline void begin_write() {
+        version.store(version.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+    }
+
+    inline void end_write() {
+        version.store(version.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+    }
+
     // ʼڵ
     void init(const float* data, int max_level) {
         vector_data = data;
@@ -58,41 +72,6 @@ struct alignas(CACHE_LINE_SIZE) HnswNode {
         if (layer >= MAX_HNSW_LEVELS) return nullptr;
         return neighbor_lists[layer].load(std::memory_order_acquire);
     }
-
-    // ޸ layer ָھ
-    void add_neighbor_rcu(int layer, uint32_t new_neighbor_id) {
-        if (layer >= MAX_HNSW_LEVELS) return;
-
-        NeighborList* old_list = neighbor_lists[layer].load(std::memory_order_relaxed); 
-        
-        while (true) {
-            size_t new_capacity = (old_list == nullptr) ? 1 : old_list->count + 1;
-            size_t alloc_size = sizeof(NeighborList) + new_capacity * sizeof(uint32_t);
-            NeighborList* new_list = (NeighborList*)std::malloc(alloc_size); 
-            
-            new_list->capacity = new_capacity;
-            new_list->count = (old_list == nullptr) ? 0 : old_list->count;
-            
-            if (old_list != nullptr) {
-                std::memcpy(new_list->neighbors, old_list->neighbors, old_list->count * sizeof(uint32_t));
-            }
-            
-            new_list->neighbors[new_list->count++] = new_neighbor_id;
-
-            if (neighbor_lists[layer].compare_exchange_weak(
-                    old_list, new_list, 
-                    std::memory_order_release, 
-                    std::memory_order_relaxed)) {
-                
-                if (old_list != nullptr) {
-                    EBRManager::get_instance().defer_free(old_list);
-                }
-                break;
-            } else {
-                std::free(new_list);
-            }
-        }
-    }
 };
 
 } // namespace vector_search
\ No newline at end of file
@@ -0,0 +1,210 @@
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstdlib>
+#include <mutex>
+#include <vector>
+#include "hnsw_node.h"
+
+namespace vector_search {
+
+// NeighborList ķּ slab ÿϲ M 0  2M ȣһߴ缶
+//  256KB  slab ϰ̶СгͷŵĿȽ̱߳ػ棬ٳ
+// üȫֿ / ͷֻ̱߳ص飬ûԭӶд
+// Ҳ glibc  arenaslab ֻֻͬڸã´СһĿն
+// EBR ڽʱͨ recycle_deleter Ѿɱ
+class NeighborListPool {
+public:
+    static constexpr size_t kSlabBytes = 256 * 1024;
+    static constexpr size_t kThreadCacheSize = 256; // ÿ̱߳໺Ŀ
+    static constexpr size_t kBlockAlign = 16;
+
+    // ⲻ˳ʱ EBR ߳ԿܰѾɱ
+    static NeighborListPool& get_instance() {
+        static NeighborListPool* instance = new NeighborListPool();
+        return *instance;
+    }
+
+    static size_t block_bytes(uint32_t capacity) {
+        size_t bytes = sizeof(NeighborList) + (size_t)capacity * sizeof(uint32_t);
+        return (bytes + kBlockAlign - 1) / kBlockAlign * kBlockAlign;
+    }
+
+    NeighborList* allocate(uint32_t capacity) {
+        NeighborList* list;
+        ThreadCache* tc = thread_cache();
+        if (tc != nullptr) {
+            std::vector<NeighborList*>& cache = tc->bucket(capacity);
+            if (cache.empty()) {
+                tc->add_cached(refill(capacity, cache, kThreadCacheSize / 2) * block_bytes(capacity));
+            }
+            list = cache.back();
+            cache.pop_back();
+            tc->add_cached(-block_bytes(capacity));
+            tc->allocations.store(tc->allocations.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        } else {
+            list = pop_global(capacity);
+        }
+        list->count = 0;
+        list->capacity = capacity;
+        return list;
+    }
+
+    void recycle(NeighborList* list) {
+        ThreadCache* tc = thread_cache();
+        if (tc == nullptr) {
+            std::lock_guard<std::mutex> lock(mutex_);
+            free_list(list->capacity).push_back(list);
+            free_bytes_ += block_bytes(list->capacity);
+            return;
+        }
+        std::vector<NeighborList*>& cache = tc->bucket(list->capacity);
+        cache.push_back(list);
+        tc->add_cached(block_bytes(list->capacity));
+        if (cache.size() > kThreadCacheSize) {
+            // ֻһ룬ֵذ
+            give_back(list->capacity, cache, kThreadCacheSize / 2);
+            tc->add_cached(-(kThreadCacheSize / 2) * block_bytes(list->capacity));
+        }
+    }
+
+    //  EBR  deleterڹɱص slabǻ
+    static void recycle_deleter(void* ptr) {
+        get_instance().recycle(static_cast<NeighborList*>(ptr));
+    }
+
+    // ---------- ָܸ̻꣨߳棬ҪҪ·ã ----------
+    uint64_t allocations() const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        uint64_t total = retired_allocations_;
+        for (const ThreadCache* tc : caches_) total += tc->allocations.load(std::memory_order_relaxed);
+        return total;
+    }
+    size_t reserved_bytes() const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return reserved_bytes_;
+    }
+    // ڱھӱʹõֽ̻߳Ŀ飩
+    size_t live_bytes() const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        size_t idle = free_bytes_;
+        for (const ThreadCache* tc : caches_) idle += tc->cached_bytes.load(std::memory_order_relaxed);
+        return reserved_bytes_ - std::min(idle, reserved_bytes_);
+    }
+    //  slab ʱеı
+    double fragmentation() const {
+        size_t reserved = reserved_bytes();
+        return reserved == 0 ? 0.0 : 1.0 - (double)live_bytes() / reserved;
+    }
+
+private:
+    // ̱߳ػ棬±Ϊֻ߳дͨ load + storeʱܡ
+    // ߳˳ʱѻĿȫȫ֮ͬһ߳ thread_local 
+    //  EBR עʱĻգֱȫ
+    struct ThreadCache {
+        std::vector<std::vector<NeighborList*>> buckets;
+        std::atomic<uint64_t> allocations{0};
+        std::atomic<size_t> cached_bytes{0};
+
+        static inline thread_local bool destroyed = false;
+
+        ThreadCache() {
+            NeighborListPool& pool = NeighborListPool::get_instance();
+            std::lock_guard<std::mutex> lock(pool.mutex_);
+            pool.caches_.push_back(this);
+        }
+
+        ~ThreadCache() {
+            NeighborListPool& pool = NeighborListPool::get_instance();
+            for (size_t capacity = 0; capacity < buckets.size(); ++capacity) {
+                pool.give_back((uint32_t)capacity, buckets[capacity], buckets[capacity].size());
+            }
+            std::lock_guard<std::mutex> lock(pool.mutex_);
+            pool.retired_allocations_ += allocations.load(std::memory_order_relaxed);
+            pool.caches_.erase(std::find(pool.caches_.begin(), pool.caches_.end(), this));
+            destroyed = true;
+        }
+
+        std::vector<NeighborList*>& bucket(uint32_t capacity) {
+            if (capacity >= buckets.size()) buckets.resize(capacity + 1);
+            return buckets[capacity];
+        }
+
+        void add_cached(size_t delta) {
+            cached_bytes.store(cached_bytes.load(std::memory_order_relaxed) + delta, std::memory_order_relaxed);
+        }
+    };
+
+    NeighborListPool() = default;
+
+    static ThreadCache* thread_cache() {
+        if (ThreadCache::destroyed) return nullptr;
+        static thread_local ThreadCache cache;
+        return &cache;
+    }
+
+    // ÷ mutex_ĳȫֿ
+    std::vector<NeighborList*>& free_list(uint32_t capacity) {
+        if (capacity >= free_.size()) free_.resize(capacity + 1);
+        return free_[capacity];
+    }
+
+    // ÷ mutex_˾һ slab 
+    std::vector<NeighborList*>& nonempty_free_list(uint32_t capacity) {
+        std::vector<NeighborList*>& list = free_list(capacity);
+        if (list.empty()) {
+            size_t block = block_bytes(capacity);
+            size_t slab_bytes = std::max(kSlabBytes, block) / block * block;
+            char* slab = (char*)std::aligned_alloc(CACHE_LINE_SIZE,
+                                                   (slab_bytes + CACHE_LINE_SIZE - 1) / CACHE_LINE_SIZE * CACHE_LINE_SIZE);
+            slabs_.push_back(slab);
+            reserved_bytes_ += slab_bytes;
+            free_bytes_ += slab_bytes;
+            for (size_t offset = slab_bytes; offset >= block; offset -= block) {
+                list.push_back(reinterpret_cast<NeighborList*>(slab + offset - block));
+            }
+        }
+        return list;
+    }
+
+    // ȫȡ n Ž̻߳棬ʵȡĿ
+    size_t refill(uint32_t capacity, std::vector<NeighborList*>& cache, size_t n) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        std::vector<NeighborList*>& list = nonempty_free_list(capacity);
+        n = std::min(list.size(), n);
+        cache.insert(cache.end(), list.end() - n, list.end());
+        list.resize(list.size() - n);
+        free_bytes_ -= n * block_bytes(capacity);
+        return n;
+    }
+
+    NeighborList* pop_global(uint32_t capacity) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        std::vector<NeighborList*>& list = nonempty_free_list(capacity);
+        NeighborList* block = list.back();
+        list.pop_back();
+        free_bytes_ -= block_bytes(capacity);
+        return block;
+    }
+
+    // ̻߳ĩβ n 黹ȫ
+    void give_back(uint32_t capacity, std::vector<NeighborList*>& cache, size_t n) {
+        if (n == 0) return;
+        std::lock_guard<std::mutex> lock(mutex_);
+        std::vector<NeighborList*>& list = free_list(capacity);
+        list.insert(list.end(), cache.end() - n, cache.end());
+        cache.resize(cache.size() - n);
+        free_bytes_ += n * block_bytes(capacity);
+    }
+
+    mutable std::mutex mutex_;
+    std::vector<std::vector<NeighborList*>> free_; // ±Ϊ
+    std::vector<char*> slabs_;
+    std::vector<ThreadCache*> caches_;
+    uint64_t retired_allocations_ = 0;
+    size_t reserved_bytes_ = 0;
+    size_t free_bytes_ = 0;
+};
+
+} // namespace vector_search
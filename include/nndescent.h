@@ -0,0 +1,191 @@
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <random>
+#include <vector>
+#include "hnsw_node.h"
+#include "work_stealing.h"
+
+namespace vector_search {
+
+struct NNDescentParams {
+    int k = 0;                // kNN ͼÿ㱣Ľ0 ʾ 2M
+    int iterations = 10;      // 
+    float sample_rate = 0.5f; // ÿÿ local join  / ھӸȡ sample_rate * k 
+    float delta = 0.001f;     // һֵĸ´ delta * n * k ʱΪ
+    int link_ef = 0;          // HNSW  0 ʱ ef0 ʾ M
+};
+
+// NN-Descent  kNN ͼ"ھӵھӺܿҲھ"ʼÿ k ڣ
+// ֮ÿֶÿģ + ھ루local joiný˫Ľڳأ
+// ֱ´㹻١local join "һһ"Ϊλ룬һ
+//  search_layer תԻѺõöࡣֻб¼ھӲźͱԣظ
+class NNDescent {
+public:
+    struct Neighbor {
+        uint32_t id;
+        float dist;
+        bool is_new; // һֲ֮ż룬û local join
+    };
+
+    // 룺 a  ids[0, n) ľд out
+    using BatchDistance = std::function<void(uint32_t a, const uint32_t* ids, size_t n, float* out)>;
+
+    NNDescent(size_t n, size_t k, const NNDescentParams& params)
+        : n_(n), k_(std::min(k, n > 0 ? n - 1 : 0)), params_(params),
+          pool_(n * k_), pool_size_(n, 0), locks_(new SpinLock[n]) {}
+
+    // ͼʵʵ
+    int build(const BatchDistance& dist, int threads) {
+        if (k_ == 0) return 0;
+        size_t sample = std::max<size_t>(1, (size_t)(params_.sample_rate * k_));
+        std::vector<std::vector<uint32_t>> new_lists(n_), old_lists(n_);
+
+        // 1. ʼ
+        WorkStealingScheduler::run(n_, threads, [&](size_t begin, size_t end, int) {
+            std::mt19937 rng((uint32_t)begin * 2654435761u + 1);
+            std::uniform_int_distribution<uint32_t> pick(0, (uint32_t)n_ - 1);
+            std::vector<uint32_t> ids;
+            std::vector<float> dists;
+            for (size_t u = begin; u < end; ++u) {
+                ids.clear();
+                while (ids.size() < k_) {
+                    uint32_t v = pick(rng);
+                    if (v != u && std::find(ids.begin(), ids.end(), v) == ids.end()) ids.push_back(v);
+                }
+                dists.resize(ids.size());
+                dist((uint32_t)u, ids.data(), ids.size(), dists.data());
+                for (size_t i = 0; i < ids.size(); ++i) update((uint32_t)u, ids[i], dists[i]);
+            }
+        });
+
+        int iter = 0;
+        while (iter < params_.iterations) {
+            ++iter;
+
+            // 2. ÿȡ sample ھӣȡΪɣ sample ھӡ
+            //    ֻдԼĽڳأԲ
+            WorkStealingScheduler::run(n_, threads, [&](size_t begin, size_t end, int) {
+                for (size_t u = begin; u < end; ++u) {
+                    new_lists[u].clear();
+                    old_lists[u].clear();
+                    Neighbor* pool = &pool_[u * k_];
+                    for (uint32_t i = 0; i < pool_size_[u]; ++i) {
+                        if (pool[i].is_new) {
+                            if (new_lists[u].size() < sample) {
+                                new_lists[u].push_back(pool[i].id);
+                                pool[i].is_new = false;
+                            }
+                        } else if (old_lists[u].size() < sample) {
+                            old_lists[u].push_back(pool[i].id);
+                        }
+                    }
+                }
+            });
+
+            // 3. ھӣu  v ĲͰ v ҲŽ u Ĳÿټ sample ˮس
+            add_reverse(new_lists, sample, iter);
+            add_reverse(old_lists, sample, iter + 0x9E3779B9u);
+
+            // 4. local join x ¡ x ԣһһ
+            std::atomic<size_t> updates{0};
+            WorkStealingScheduler::run(n_, threads, [&](size_t begin, size_t end, int) {
+                std::vector<uint32_t> targets;
+                std::vector<float> dists;
+                size_t local_updates = 0;
+                for (size_t u = begin; u < end; ++u) {
+                    const std::vector<uint32_t>& nw = new_lists[u];
+                    const std::vector<uint32_t>& od = old_lists[u];
+                    for (size_t i = 0; i < nw.size(); ++i) {
+                        uint32_t a = nw[i];
+                        targets.clear();
+                        for (size_t j = i + 1; j < nw.size(); ++j) {
+                            if (nw[j] != a) targets.push_back(nw[j]);
+                        }
+                        for (uint32_t b : od) {
+                            if (b != a) targets.push_back(b);
+                        }
+                        if (targets.empty()) continue;
+                        dists.resize(targets.size());
+                        dist(a, targets.data(), targets.size(), dists.data());
+                        for (size_t j = 0; j < targets.size(); ++j) {
+                            local_updates += update(a, targets[j], dists[j]);
+                            local_updates += update(targets[j], a, dists[j]);
+                        }
+                    }
+                }
+                updates.fetch_add(local_updates, std::memory_order_relaxed);
+            });
+
+            if (updates.load() < params_.delta * n_ * k_) break;
+        }
+        return iter;
+    }
+
+    // u ĽڣɽԶ
+    const Neighbor* neighbors(uint32_t u) const { return &pool_[(size_t)u * k_]; }
+    uint32_t size(uint32_t u) const { return pool_size_[u]; }
+
+private:
+    //  v  u Ľڳأȥء˼ԶģǷб仯
+    size_t update(uint32_t u, uint32_t v, float d) {
+        Neighbor* pool = &pool_[(size_t)u * k_];
+        uint32_t& size = pool_size_[u];
+        SpinLock& lock = locks_[u];
+        lock.lock();
+        if (size == k_ && d >= pool[k_ - 1].dist) {
+            lock.unlock();
+            return 0;
+        }
+        for (uint32_t i = 0; i < size; ++i) {
+            if (pool[i].id == v) {
+                lock.unlock();
+                return 0;
+            }
+        }
+        size_t pos = size < k_ ? size : k_ - 1;
+        while (pos > 0 && pool[pos - 1].dist > d) {
+            pool[pos] = pool[pos - 1];
+            --pos;
+        }
+        pool[pos] = {v, d, true};
+        if (size < k_) ++size;
+        lock.unlock();
+        return 1;
+    }
+
+    // й췴O(n * sample) local join Ժԣ
+    void add_reverse(std::vector<std::vector<uint32_t>>& lists, size_t sample, uint32_t seed) {
+        std::vector<std::vector<uint32_t>> reverse(n_);
+        std::vector<uint32_t> seen(n_, 0);
+        std::mt19937 rng(seed);
+        for (size_t v = 0; v < n_; ++v) {
+            for (uint32_t u : lists[v]) {
+                uint32_t count = ++seen[u];
+                if (reverse[u].size() < sample) {
+                    reverse[u].push_back((uint32_t)v);
+                } else {
+                    uint32_t slot = std::uniform_int_distribution<uint32_t>(0, count - 1)(rng);
+                    if (slot < sample) reverse[u][slot] = (uint32_t)v;
+                }
+            }
+        }
+        for (size_t u = 0; u < n_; ++u) {
+            for (uint32_t v : reverse[u]) {
+                if (std::find(lists[u].begin(), lists[u].end(), v) == lists[u].end()) lists[u].push_back(v);
+            }
+        }
+    }
+
+    size_t n_;
+    size_t k_;
+    NNDescentParams params_;
+    std::vector<Neighbor> pool_;     // ÿ k_ λɽԶ
+    std::vector<uint32_t> pool_size_;
+    std::unique_ptr<SpinLock[]> locks_;
+};
+
+} // namespace vector_search
@@ -0,0 +1,142 @@
+#pragma once
+#include <algorithm>
+#include <cstdint>
+#include <limits>
+#include <random>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+#include "distance.h"
+
+namespace vector_search {
+
+// ˻ (PQ) dim άг m ӿռ䣬ÿӿռ 256  k-means ࣬
+// ֻ m  1 ֽڵıšѯʱΪÿӿռ"ѯ 256 "
+// ľ (m x 256  floatܷŽ L1)֮κֵľ붼ֻ m β (ADC)
+// Ŀǰֻ֧ L2 
+struct ProductQuantizer {
+    static constexpr size_t kCentroids = 256;
+
+    size_t dim = 0;
+    size_t m = 0;     // ӿռ = ÿֵֽ
+    size_t dsub = 0;  // ÿӿռά
+    std::vector<float> centroids; // [m][256][dsub]
+    bool trained = false;
+
+    // ѵ max_train ӿռ k-means ָ̲߳
+    void train(const float* data, size_t n, size_t d, size_t num_subspaces,
+               int iterations = 20, size_t max_train = 256 * 100) {
+        if (num_subspaces == 0 || d % num_subspaces != 0) {
+            throw std::invalid_argument("PQ: dim must be divisible by the number of subspaces");
+        }
+        if (n == 0) {
+            throw std::invalid_argument("PQ: empty training set");
+        }
+        dim = d;
+        m = num_subspaces;
+        dsub = dim / m;
+        centroids.assign(m * kCentroids * dsub, 0.0f);
+
+        // ̶ӳ֤ͬһѵͬһ뱾
+        std::mt19937 rng(1234);
+        std::vector<size_t> sample(n);
+        for (size_t i = 0; i < n; ++i) sample[i] = i;
+        if (n > max_train) {
+            std::shuffle(sample.begin(), sample.end(), rng);
+            sample.resize(max_train);
+        }
+
+        size_t num_threads = std::max<size_t>(1, std::min<size_t>(m, std::thread::hardware_concurrency()));
+        std::vector<std::thread> threads;
+        for (size_t t = 0; t < num_threads; ++t) {
+            threads.emplace_back([&, t]() {
+                std::vector<float> sub(sample.size() * dsub);
+                for (size_t s = t; s < m; s += num_threads) {
+                    for (size_t i = 0; i < sample.size(); ++i) {
+                        const float* x = data + sample[i] * dim + s * dsub;
+                        std::copy(x, x + dsub, sub.begin() + i * dsub);
+                    }
+                    kmeans(sub.data(), sample.size(), centroids.data() + s * kCentroids * dsub,
+                           iterations, 4321 + s);
+                }
+            });
+        }
+        for (auto& thread : threads) {
+            thread.join();
+        }
+        trained = true;
+    }
+
+    // 룺ÿӿռȡı
+    void encode(const float* x, uint8_t* code) const {
+        for (size_t s = 0; s < m; ++s) {
+            code[s] = (uint8_t)nearest(x + s * dsub, centroids.data() + s * kCentroids * dsub, kCentroids);
+        }
+    }
+
+    // ѯtable[s * 256 + c] = ||q_s - centroid_{s,c}||^2
+    void compute_distance_table(const float* query, float* table) const {
+        for (size_t s = 0; s < m; ++s) {
+            const float* q = query + s * dsub;
+            const float* cent = centroids.data() + s * kCentroids * dsub;
+            for (size_t c = 0; c < kCentroids; ++c) {
+                table[s * kCentroids + c] = l2_distance(q, cent + c * dsub, dsub);
+            }
+        }
+    }
+
+    size_t codebook_bytes() const { return centroids.size() * sizeof(float); }
+
+private:
+    size_t nearest(const float* x, const float* cent, size_t k) const {
+        size_t best = 0;
+        float best_dist = std::numeric_limits<float>::max();
+        for (size_t c = 0; c < k; ++c) {
+            float d = l2_distance(x, cent + c * dsub, dsub);
+            if (d < best_dist) {
+                best_dist = d;
+                best = c;
+            }
+        }
+        return best;
+    }
+
+    // Lloyd k-meansʼմ²
+    void kmeans(const float* x, size_t n, float* cent, int iterations, unsigned seed) const {
+        std::mt19937 rng(seed);
+        std::uniform_int_distribution<size_t> pick(0, n - 1);
+        for (size_t c = 0; c < kCentroids; ++c) {
+            const float* src = x + pick(rng) * dsub;
+            std::copy(src, src + dsub, cent + c * dsub);
+        }
+
+        std::vector<uint32_t> assign(n);
+        std::vector<float> sums(kCentroids * dsub);
+        std::vector<uint32_t> counts(kCentroids);
+        for (int iter = 0; iter < iterations; ++iter) {
+            for (size_t i = 0; i < n; ++i) {
+                assign[i] = (uint32_t)nearest(x + i * dsub, cent, kCentroids);
+            }
+
+            std::fill(sums.begin(), sums.end(), 0.0f);
+            std::fill(counts.begin(), counts.end(), 0);
+            for (size_t i = 0; i < n; ++i) {
+                float* sum = sums.data() + assign[i] * dsub;
+                const float* xi = x + i * dsub;
+                for (size_t j = 0; j < dsub; ++j) sum[j] += xi[j];
+                counts[assign[i]]++;
+            }
+            for (size_t c = 0; c < kCentroids; ++c) {
+                if (counts[c] == 0) {
+                    const float* src = x + pick(rng) * dsub;
+                    std::copy(src, src + dsub, cent + c * dsub);
+                    continue;
+                }
+                float inv = 1.0f / counts[c];
+                for (size_t j = 0; j < dsub; ++j) cent[c * dsub + j] = sums[c * dsub + j] * inv;
+            }
+        }
+    }
+};
+
+} // namespace vector_search
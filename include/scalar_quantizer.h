@@ -0,0 +1,57 @@
+#pragma once
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+namespace vector_search {
+
+// 8 bit  (SQ8)ÿһά 1 ֽڣڴʹֻ float  1/4
+// ÿһάѵ min/max Ϊ㣻ȡά (max - min) / 255
+// άͬһֿռ L2 ԭʼ float L2 ֻһ
+// ͼֱ SIMD ں˱Ƚ֣ float ž
+struct ScalarQuantizer {
+    size_t dim = 0;
+    std::vector<float> vmin; // ÿһάСֵ㣩
+    std::vector<float> vmax; // ÿһάֵ
+    float step = 1.0f;       // 
+    bool trained = false;
+
+    // һͳÿһά min/maxbulk load ʱȫѵ
+    void train(const float* data, size_t n, size_t d) {
+        dim = d;
+        vmin.assign(dim, std::numeric_limits<float>::max());
+        vmax.assign(dim, std::numeric_limits<float>::lowest());
+        for (size_t i = 0; i < n; ++i) {
+            const float* x = data + i * dim;
+            for (size_t j = 0; j < dim; ++j) {
+                vmin[j] = std::min(vmin[j], x[j]);
+                vmax[j] = std::max(vmax[j], x[j]);
+            }
+        }
+        float max_range = 0.0f;
+        for (size_t j = 0; j < dim; ++j) {
+            max_range = std::max(max_range, vmax[j] - vmin[j]);
+        }
+        step = (max_range > 0.0f) ? max_range / 255.0f : 1.0f;
+        trained = true;
+    }
+
+    // 룺ѵΧֵضϵ [0, 255]
+    void encode(const float* x, uint8_t* code) const {
+        float inv_step = 1.0f / step;
+        for (size_t j = 0; j < dim; ++j) {
+            float v = std::round((x[j] - vmin[j]) * inv_step);
+            v = std::min(255.0f, std::max(0.0f, v));
+            code[j] = (uint8_t)v;
+        }
+    }
+
+    // ֿռ L2 ԭΪ float ռ L2ֻһʱҪ
+    float to_float_l2(uint32_t code_dist) const {
+        return (float)code_dist * step * step;
+    }
+};
+
+} // namespace vector_search
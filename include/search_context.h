@@ -0,0 +1,170 @@
+#pragma once
+#include <algorithm>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <vector>
+#include "visited_table.h"
+
+namespace vector_search {
+
+struct NodeDist {
+    uint32_t id;
+    float dist;
+    bool operator<(const NodeDist& other) const { return dist < other.dist; }
+    bool operator>(const NodeDist& other) const { return dist > other.dist; }
+};
+
+// һѯʱõȫɸ״̬ѡѡѡvisited ǡ
+// ѯ;ŵʱ顣ֻڵһõ ef / ݹģʱݣ
+// ֮󷴸ʹͬһ SearchContext ٴڴ档
+// һ SearchContext ͬһʱֻܱһ߳ʹ
+class SearchContext {
+public:
+    // ---------- visited  ----------
+    // ʼһµıuse_hash Ϊ trueС ef費ʱԴĹϣϣ
+    // ӳһŸȫ visited  end_visit 黹
+    void begin_visit(VisitedTablePool& pool, size_t expected_visits, bool use_hash) {
+        table_ = use_hash ? nullptr : pool.acquire();
+        if (table_ != nullptr) {
+            table_->reset();
+        } else {
+            hash_.reset(expected_visits);
+        }
+    }
+
+    void end_visit(VisitedTablePool& pool) {
+        if (table_ != nullptr) {
+            pool.release(table_);
+            table_ = nullptr;
+        }
+    }
+
+    //  id ѷʣ֮ǰǷѾʹ
+    inline bool test_and_visit(uint32_t id) {
+        return table_ != nullptr ? table_->test_and_visit(id) : hash_.test_and_visit(id);
+    }
+
+    // ---------- ѡѣСѣڶѶѣ󶥶ѣԶڶѶ ----------
+    void reset_heaps(size_t ef) {
+        candidates_.clear();
+        top_.clear();
+        candidates_.reserve(ef + 1);
+        top_.reserve(ef + 1);
+    }
+
+    bool candidates_empty() const { return candidates_.empty(); }
+    const NodeDist& candidates_top() const { return candidates_.front(); }
+    void push_candidate(NodeDist nd) {
+        candidates_.push_back(nd);
+        std::push_heap(candidates_.begin(), candidates_.end(), std::greater<NodeDist>());
+    }
+    void pop_candidate() {
+        std::pop_heap(candidates_.begin(), candidates_.end(), std::greater<NodeDist>());
+        candidates_.pop_back();
+    }
+
+    size_t top_size() const { return top_.size(); }
+    const NodeDist& top_worst() const { return top_.front(); }
+    void push_top(NodeDist nd) {
+        top_.push_back(nd);
+        std::push_heap(top_.begin(), top_.end());
+    }
+    void pop_top() {
+        std::pop_heap(top_.begin(), top_.end());
+        top_.pop_back();
+    }
+
+    // ѽԭųɽԶ results()ѹͬһڴ棩
+    void sort_top_into_results() {
+        std::sort_heap(top_.begin(), top_.end());
+        results_.swap(top_);
+    }
+
+    // search_layer ɽԶ (id, )
+    std::vector<NodeDist>& results() { return results_; }
+
+    // search_knn ⷵص id
+    std::vector<uint32_t>& ids() { return ids_; }
+
+    // һھӱգܷ max_degree ھ
+    uint32_t* neighbor_snapshot(size_t max_degree) {
+        if (neighbor_snapshot_.size() < max_degree) neighbor_snapshot_.resize(max_degree);
+        return neighbor_snapshot_.data();
+    }
+
+    // ---------- ѯԤʱ ----------
+    std::vector<uint8_t>& sq8_code() { return sq8_code_; }
+    std::vector<float>& pq_table() { return pq_table_; }
+    std::vector<uint64_t>& bin_code() { return bin_code_; }
+    std::vector<float>& dists() { return dists_; }
+
+private:
+    VisitedTable* table_ = nullptr; // α visited Ϊʱ hash_
+    VisitedHashSet hash_;
+
+    std::vector<NodeDist> candidates_;
+    std::vector<NodeDist> top_;
+    std::vector<NodeDist> results_;
+    std::vector<uint32_t> ids_;
+    std::vector<uint32_t> neighbor_snapshot_;
+
+    std::vector<uint8_t> sq8_code_;
+    std::vector<float> pq_table_;
+    std::vector<uint64_t> bin_code_;
+    std::vector<float> dists_;
+};
+
+// SearchContext أbrpc worker̨ flush ̰߳ã黹
+// Ķʷ󲢷߳
+class SearchContextPool {
+public:
+    std::unique_ptr<SearchContext> acquire() {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (!free_.empty()) {
+                std::unique_ptr<SearchContext> ctx = std::move(free_.back());
+                free_.pop_back();
+                return ctx;
+            }
+            ++created_;
+        }
+        return std::unique_ptr<SearchContext>(new SearchContext());
+    }
+
+    void release(std::unique_ptr<SearchContext> ctx) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        free_.push_back(std::move(ctx));
+    }
+
+    // һ SearchContext 
+    size_t created() const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return created_;
+    }
+
+private:
+    mutable std::mutex mutex_;
+    std::vector<std::unique_ptr<SearchContext>> free_;
+    size_t created_ = 0;
+};
+
+// ڴӳһ SearchContextʱ黹
+class ScopedSearchContext {
+public:
+    explicit ScopedSearchContext(SearchContextPool& pool) : pool_(pool), ctx_(pool.acquire()) {}
+    ~ScopedSearchContext() { pool_.release(std::move(ctx_)); }
+    ScopedSearchContext(const ScopedSearchContext&) = delete;
+    ScopedSearchContext& operator=(const ScopedSearchContext&) = delete;
+
+    SearchContext& operator*() { return *ctx_; }
+    SearchContext* operator->() { return ctx_.get(); }
+    SearchContext* get() { return ctx_.get(); }
+
+private:
+    SearchContextPool& pool_;
+    std::unique_ptr<SearchContext> ctx_;
+};
+
+} // namespace vector_search
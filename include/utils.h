@@ -4,6 +4,7 @@
 #include <vector>
 #include <string>
 #include <stdexcept>
+#include <unistd.h>
 
 namespace vector_search {
 
@@ -66,4 +67,12 @@ inline std::vector<std::vector<uint32_t>> load_ivecs(const std::string& filename
     return data;
 }
 
+// ǰ̵ĳפڴ (RSS)λֽڣ /proc ʱ 0
+inline size_t read_rss_bytes() {
+    std::ifstream statm("/proc/self/statm");
+    size_t total_pages = 0, resident_pages = 0;
+    if (!(statm >> total_pages >> resident_pages)) return 0;
+    return resident_pages * (size_t)sysconf(_SC_PAGESIZE);
+}
+
 } // namespace vector_search
\ No newline at end of file
@@ -0,0 +1,194 @@
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <vector>
+
+namespace vector_search {
+
+//  visited ÿڵһ 16 λԪǣǵڵǰԪѷʡ
+// ʼµıֻԪһ65535 αһΣ 32 λ汾ʡһڴ
+class VisitedTable {
+public:
+    explicit VisitedTable(size_t max_elements) : tags_(max_elements, 0), epoch_(0) {}
+
+    size_t capacity() const { return tags_.size(); }
+
+    void reset() {
+        if (++epoch_ == 0) {
+            std::memset(tags_.data(), 0, tags_.size() * sizeof(uint16_t));
+            epoch_ = 1;
+        }
+    }
+
+    //  id ѷʣ֮ǰǷѾʹ
+    inline bool test_and_visit(uint32_t id) {
+        if (tags_[id] == epoch_) return true;
+        tags_[id] = epoch_;
+        return false;
+    }
+
+    size_t memory_bytes() const { return tags_.size() * sizeof(uint16_t); }
+
+private:
+    friend class VisitedTablePool;
+
+    std::vector<uint16_t> tags_;
+    uint16_t epoch_;
+    uint32_t slot_ = 0; // ±
+};
+
+// С ef ѯõĿѰַϣϣ̽⣩һαֻʼٵǧڵ㣬
+// ܷŽ L1 / L2ڸȫĴдʡ棬Ҳռ visited 
+// س 1/2 ʱؽreset Ҫȫλ 4 ʱȥ
+// żһδ ef ѯѼϳŴ֮󣬺СѯÿζһŴ
+class VisitedHashSet {
+public:
+    // ʼµıexpected ΪԤƷʵĽڵ
+    void reset(size_t expected) {
+        size_t want = 64;
+        while (want < expected * 2) want <<= 1;
+        if (slots_.size() < want || slots_.size() > want * kShrinkRatio) {
+            slots_.assign(want, kEmpty);
+            slots_.shrink_to_fit();
+        } else {
+            std::memset(slots_.data(), 0xFF, slots_.size() * sizeof(uint32_t));
+        }
+        set_capacity_bits();
+        size_ = 0;
+    }
+
+    inline bool test_and_visit(uint32_t id) {
+        size_t pos = hash(id);
+        while (true) {
+            uint32_t slot = slots_[pos];
+            if (slot == id) return true;
+            if (slot == kEmpty) break;
+            pos = (pos + 1) & mask_;
+        }
+        slots_[pos] = id;
+        if (++size_ * 2 > slots_.size()) grow();
+        return false;
+    }
+
+private:
+    static constexpr uint32_t kEmpty = 0xFFFFFFFF;
+    static constexpr size_t kShrinkRatio = 4;
+
+    // Fibonacci ɢУ 2^64 / ƽȡ˻ĸ log2() λλ id ȫλ
+    //  id ֻڸλͬ id ܴɢ
+    inline size_t hash(uint32_t id) const {
+        return (size_t)(((uint64_t)id * 0x9E3779B97F4A7C15ull) >> shift_);
+    }
+
+    void set_capacity_bits() {
+        mask_ = slots_.size() - 1;
+        shift_ = 64 - (unsigned)__builtin_ctzll((unsigned long long)slots_.size());
+    }
+
+    void grow() {
+        std::vector<uint32_t> old;
+        old.swap(slots_);
+        slots_.assign(old.size() * 2, kEmpty);
+        set_capacity_bits();
+        for (uint32_t id : old) {
+            if (id == kEmpty) continue;
+            size_t pos = hash(id);
+            while (slots_[pos] != kEmpty) pos = (pos + 1) & mask_;
+            slots_[pos] = id;
+        }
+    }
+
+    std::vector<uint32_t> slots_;
+    size_t mask_ = 0;
+    unsigned shift_ = 64; // 64 - log2()hash ȡ˻ĸλ
+    size_t size_ = 0;
+};
+
+// ޵ visited أÿ search_layer һš黹
+// 沢ѯ max_tables ţ߳޹أ
+// ûпбʱɵ÷˻صϣϣ
+// 軹ÿ search_layer ·ϣбջTreiber stack
+// ջ 64 λ (汾 << 32 | ± + 1)ÿ޸İ汾żһ ABA
+// ֻڳʱͷţ±Ŀ¼һԷ kMaxTables 
+class VisitedTablePool {
+public:
+    static constexpr size_t kMaxTables = 1024;
+
+    VisitedTablePool(size_t max_elements, size_t max_tables)
+        : max_elements_(max_elements), max_tables_(std::min(max_tables, kMaxTables)), created_(0),
+          tables_(new std::unique_ptr<VisitedTable>[kMaxTables]),
+          next_free_(new std::atomic<uint32_t>[kMaxTables]), free_head_(0),
+          acquires_(0), hits_(0), fallbacks_(0) {}
+
+    // һűûпбѴʱ nullptr
+    VisitedTable* acquire() {
+        acquires_.fetch_add(1, std::memory_order_relaxed);
+        uint64_t head = free_head_.load(std::memory_order_acquire);
+        while ((uint32_t)head != 0) {
+            uint32_t slot = (uint32_t)head - 1;
+            uint64_t next = ((head >> 32) + 1) << 32 | next_free_[slot].load(std::memory_order_relaxed);
+            if (free_head_.compare_exchange_weak(head, next, std::memory_order_acquire,
+                                                 std::memory_order_acquire)) {
+                hits_.fetch_add(1, std::memory_order_relaxed);
+                return tables_[slot].get();
+            }
+        }
+
+        // ûпбռһ±꣬±ڵ߳Ϸ
+        size_t slot = created_.load(std::memory_order_relaxed);
+        do {
+            if (slot >= max_tables_.load(std::memory_order_relaxed)) {
+                fallbacks_.fetch_add(1, std::memory_order_relaxed);
+                return nullptr;
+            }
+        } while (!created_.compare_exchange_weak(slot, slot + 1, std::memory_order_relaxed));
+        VisitedTable* table = new VisitedTable(max_elements_);
+        table->slot_ = (uint32_t)slot;
+        tables_[slot].reset(table);
+        return table;
+    }
+
+    void release(VisitedTable* table) {
+        uint32_t slot = table->slot_;
+        uint64_t head = free_head_.load(std::memory_order_relaxed);
+        uint64_t next;
+        do {
+            next_free_[slot].store((uint32_t)head, std::memory_order_relaxed);
+            next = ((head >> 32) + 1) << 32 | (slot + 1);
+        } while (!free_head_.compare_exchange_weak(head, next, std::memory_order_release,
+                                                   std::memory_order_relaxed));
+    }
+
+    // ֻǲ½Ѿıڳ
+    void set_max_tables(size_t max_tables) {
+        max_tables_.store(std::min(max_tables, kMaxTables), std::memory_order_relaxed);
+    }
+
+    // ---------- ָ ----------
+    size_t size() const { return created_.load(std::memory_order_relaxed); }
+    size_t max_tables() const { return max_tables_.load(std::memory_order_relaxed); }
+    size_t memory_bytes() const { return size() * max_elements_ * sizeof(uint16_t); }
+    uint64_t acquires() const { return acquires_.load(std::memory_order_relaxed); }
+    uint64_t fallbacks() const { return fallbacks_.load(std::memory_order_relaxed); }
+    // ʱֱõб½Ҳû˻عϣϣı
+    double hit_rate() const {
+        uint64_t total = acquires();
+        return total == 0 ? 1.0 : (double)hits_.load(std::memory_order_relaxed) / total;
+    }
+
+private:
+    size_t max_elements_;
+    std::atomic<size_t> max_tables_;
+    std::atomic<size_t> created_;
+    std::unique_ptr<std::unique_ptr<VisitedTable>[]> tables_;
+    std::unique_ptr<std::atomic<uint32_t>[]> next_free_; // ջһű± + 10 ʾջ
+    std::atomic<uint64_t> free_head_;
+    std::atomic<uint64_t> acquires_;
+    std::atomic<uint64_t> hits_;
+    std::atomic<uint64_t> fallbacks_;
+};
+
+} // namespace vector_search
@@ -0,0 +1,113 @@
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+namespace vector_search {
+
+// ȡĲ for[0, n) Ⱦָ̣߳ÿ̴߳Լǰ˰ chunk ȡ
+// Լ󣬴߳ʣĺ͵һν
+// ÿһ 64 λ (begin, end)ȡ͵ֻһ CAS
+// ͼʱ߲ڵĲͨڵö̶࣬ø߳ϵ͵β̯ƽ
+class WorkStealingScheduler {
+public:
+    static constexpr size_t kDefaultChunk = 32;
+
+    // body(begin, end, worker) [begin, end)worker Ϊ̱߳ [0, threads)
+    using Body = std::function<void(size_t begin, size_t end, int worker)>;
+    // progress(done, total)ÿһ chunk һΣ֮߳䴮е
+    using Progress = std::function<void(size_t done, size_t total)>;
+
+    // ֱ [0, n) ȫꡣthreads <= 0 ʱʹȫ CPU ģ߳ԼҲ֮һ
+    static void run(size_t n, int threads, const Body& body, const Progress& progress = nullptr,
+                    size_t chunk = kDefaultChunk) {
+        if (n == 0) return;
+        if (n > UINT32_MAX) {
+            throw std::invalid_argument("WorkStealingScheduler: range too large");
+        }
+        if (threads <= 0) threads = (int)std::max(1u, std::thread::hardware_concurrency());
+        chunk = std::max<size_t>(1, chunk);
+
+        std::vector<Slot> slots(threads);
+        for (int t = 0; t < threads; ++t) {
+            slots[t].range.store(pack(n * t / threads, n * (t + 1) / threads), std::memory_order_relaxed);
+        }
+
+        std::mutex progress_mutex;
+        size_t done = 0;
+        auto worker = [&](int w) {
+            size_t begin, end;
+            while (true) {
+                if (!pop(slots[w], chunk, begin, end)) {
+                    if (!steal(slots, w, chunk)) break;
+                    continue;
+                }
+                body(begin, end, w);
+                if (progress) {
+                    std::lock_guard<std::mutex> lock(progress_mutex);
+                    done += end - begin;
+                    progress(done, n);
+                }
+            }
+        };
+
+        std::vector<std::thread> workers;
+        for (int t = 1; t < threads; ++t) {
+            workers.emplace_back(worker, t);
+        }
+        worker(0);
+        for (auto& t : workers) {
+            t.join();
+        }
+    }
+
+private:
+    struct alignas(64) Slot {
+        std::atomic<uint64_t> range{0};
+    };
+
+    static uint64_t pack(size_t begin, size_t end) { return ((uint64_t)begin << 32) | (uint64_t)end; }
+    static size_t range_begin(uint64_t range) { return (size_t)(range >> 32); }
+    static size_t range_end(uint64_t range) { return (size_t)(range & 0xFFFFFFFFu); }
+
+    // Լǰȡ chunk 
+    static bool pop(Slot& slot, size_t chunk, size_t& begin, size_t& end) {
+        uint64_t range = slot.range.load(std::memory_order_acquire);
+        while (true) {
+            begin = range_begin(range);
+            size_t limit = range_end(range);
+            if (begin >= limit) return false;
+            end = std::min(begin + chunk, limit);
+            if (slot.range.compare_exchange_weak(range, pack(end, limit), std::memory_order_acq_rel)) {
+                return true;
+            }
+        }
+    }
+
+    // ߳ʣ͵ΪԼ䣻ֻʣ chunk Լ
+    static bool steal(std::vector<Slot>& slots, int self, size_t chunk) {
+        int threads = (int)slots.size();
+        for (int i = 1; i < threads; ++i) {
+            Slot& victim = slots[(self + i) % threads];
+            uint64_t range = victim.range.load(std::memory_order_acquire);
+            while (true) {
+                size_t begin = range_begin(range);
+                size_t end = range_end(range);
+                if (begin >= end || end - begin < 2 * chunk) break;
+                size_t mid = begin + (end - begin) / 2;
+                if (victim.range.compare_exchange_weak(range, pack(begin, mid), std::memory_order_acq_rel)) {
+                    slots[self].range.store(pack(mid, end), std::memory_order_release);
+                    return true;
+                }
+            }
+        }
+        return false;
+    }
+};
+
+} // namespace vector_search
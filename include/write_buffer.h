@@ -1,35 +1,79 @@
 #pragma once
+#include <algorithm>
 #include <atomic>
+#include <queue>
 #include <vector>
 #include <cstring>
+#include <cstdint>
 #include <cstdlib>
 #include <immintrin.h> // for AVX2 alignment
+#include "atomic_bitset.h"
+#include "attribute_filter.h"
 #include "distance.h"
+#include "search_context.h"
 
 namespace vector_search {
 
 // 뵽 64 ֽڣڲ״̬α (False Sharing)
 struct alignas(64) FlatWriteBuffer {
-    float* data;                     //  32 ֽڶڴ
+    float* data;                     //  32 ֽڶڴأFloat32 洢
+    uint16_t* half_data;             // FP16 / BF16 洢ʱİ뾫ڴأ data ѡһ
     uint32_t* ids;                   // Ӧ ID 
+    uint64_t* seqs;                  // ÿλдţͬһ id дʱֻµһݿɼ
+    uint32_t* tags;                  // ÿλԣǩǩλͼдŹ SIMD 
+    uint64_t* labels;
     std::atomic<size_t> count;       // ǰд
     size_t capacity;
     size_t dim;
+    size_t id_limit;                 // Ϸ id Ͻ磨 latest_seq ĳ
+    MetricType metric;
+    DistanceFunc dist_func;          // άʱַľں
+    float* inv_norms;                // Ҷʹãдʱ 1/||x||
+    float* sq_norms;                 //  L2 + Float32 ʹãдʱ ||x||^2ɨչ
+    VectorStorage storage;
+    HalfDistanceFunc half_dist_func; // 뾫ȴ洢ʱľںˣʱת fp32
+    AtomicBitset deleted;            // ɾĲλɨʱˢ HNSW ʱ
+    FilterBitmapFunc filter_bitmap_func; // ɨʱȽϳλͼں
 
-    FlatWriteBuffer(size_t cap, size_t d) : count(0), capacity(cap), dim(d) {
+    FlatWriteBuffer(size_t cap, size_t d, MetricType m = MetricType::L2,
+                    VectorStorage s = VectorStorage::Float32, size_t max_ids = SIZE_MAX)
+        : data(nullptr), half_data(nullptr), count(0), capacity(cap), dim(d), id_limit(max_ids), metric(m),
+          dist_func(get_distance_func(m, d)), inv_norms(nullptr), sq_norms(nullptr), storage(s),
+          half_dist_func(get_half_distance_func(m, s)), deleted(cap), filter_bitmap_func(get_filter_bitmap_func()) {
         // ǿ 32 ֽڶ룬ӭ AVX2  _mm256_load_ps ָ
-        data = (float*)std::aligned_alloc(32, capacity * dim * sizeof(float));
+        if (storage == VectorStorage::Float32) {
+            data = (float*)std::aligned_alloc(32, capacity * dim * sizeof(float));
+        } else {
+            size_t bytes = (capacity * dim * sizeof(uint16_t) + 31) / 32 * 32;
+            half_data = (uint16_t*)std::aligned_alloc(32, bytes);
+        }
         ids = (uint32_t*)std::aligned_alloc(32, capacity * sizeof(uint32_t));
+        seqs = (uint64_t*)std::malloc(capacity * sizeof(uint64_t));
+        tags = (uint32_t*)std::aligned_alloc(32, (capacity * sizeof(uint32_t) + 31) / 32 * 32);
+        labels = (uint64_t*)std::aligned_alloc(32, (capacity * sizeof(uint64_t) + 31) / 32 * 32);
+        if (metric == MetricType::Cosine) {
+            inv_norms = (float*)std::malloc(capacity * sizeof(float));
+        }
+        if (metric == MetricType::L2 && storage == VectorStorage::Float32) {
+            sq_norms = (float*)std::malloc(capacity * sizeof(float));
+        }
     }
 
     ~FlatWriteBuffer() {
         std::free(data);
+        std::free(half_data);
         std::free(ids);
+        std::free(seqs);
+        std::free(tags);
+        std::free(labels);
+        std::free(inv_norms);
+        std::free(sq_norms);
     }
 
     // дWait-Free ׷ӡ
     //  false  Buffer Ҫ˫л
-    inline bool append_wait_free(const float* vec, uint32_t id) {
+    inline bool append_wait_free(const float* vec, uint32_t id, uint64_t seq = 0,
+                                 const VectorAttributes& attrs = VectorAttributes()) {
         // ԭӻȡλ (XADD ָٷ)
         size_t idx = count.fetch_add(1, std::memory_order_relaxed);
         
@@ -40,8 +84,21 @@ struct alignas(64) FlatWriteBuffer {
         //  memcpy רĲλ
         // ע⣺ΪǴ request->query_vector()
         // һѹե AVX2 רдһٿ
-        std::memcpy(data + idx * dim, vec, dim * sizeof(float));
+        if (half_data != nullptr) {
+            encode_half(storage, vec, half_data + idx * dim, dim);
+        } else {
+            std::memcpy(data + idx * dim, vec, dim * sizeof(float));
+        }
         ids[idx] = id;
+        seqs[idx] = seq;
+        tags[idx] = attrs.tag;
+        labels[idx] = attrs.labels;
+        if (inv_norms != nullptr) {
+            inv_norms[idx] = compute_inv_norm(vec, dim);
+        }
+        if (sq_norms != nullptr) {
+            sq_norms[idx] = compute_sq_norm(vec, dim);
+        }
 
         // Ӳ˵ϸڡΪ˷̶ֹ߳ memcpy ûдİ;
         // ʵʹҵʵҪһ version/commit_count ͨ release ϱ
@@ -49,21 +106,157 @@ struct alignas(64) FlatWriteBuffer {
         return true;
     }
 
+    // ɾ id ڱ Buffer иͬһ id ܱдΣɾĸ
+    size_t remove(uint32_t id) {
+        size_t current_sz = count.load(std::memory_order_acquire);
+        if (current_sz > capacity) current_sz = capacity;
+        size_t removed = 0;
+        for (size_t i = 0; i < current_sz; ++i) {
+            if (ids[i] == id && !deleted.set(i)) ++removed;
+        }
+        return removed;
+    }
+
+    //  i  fp32 ͼFloat32 ֱӷزλַ뾫Ƚ뵽 scratch
+    inline const float* vector_at(size_t i, float* scratch) const {
+        if (half_data == nullptr) return data + i * dim;
+        decode_half(storage, half_data + i * dim, scratch, dim);
+        return scratch;
+    }
+
+    // λǷѱͬһ id µдȡlatest_seq Ϊʱжϣ
+    // ֻھ㹻ʱŲ飬ɨѭﲻһô档
+    // count ڲλݵ߿ܿûдĲλids[i] δʼֵ
+    // Խ id ȥ latest_seq
+    inline bool is_stale(size_t i, const std::atomic<uint64_t>* latest_seq) const {
+        if (latest_seq == nullptr) return false;
+        uint32_t id = ids[i];
+        return id >= id_limit || seqs[i] != latest_seq[id].load(std::memory_order_acquire);
+    }
+
     // ¶ɨ Brute-force
-    // ֱ߳ӱɨڴ棬ӲԤȡ (Prefetcher) 
-    void search_brute_force(const float* query, int k, std::priority_queue<NodeDist>& top_candidates) const {
+    // ֱ߳ӱɨڴ棬ӲԤȡ (Prefetcher) С
+    // filter ǿʱ SIMD ں˰бȽϳλͼɾλͼ룬ֻΪеĲλ
+    void search_brute_force(const float* query, int k, std::priority_queue<NodeDist>& top_candidates,
+                            const std::atomic<uint64_t>* latest_seq = nullptr,
+                            const AttributeFilter* filter = nullptr) const {
         // acquire 屣֤ count д߳ commit ֮ĴС
         size_t current_sz = count.load(std::memory_order_acquire);
         if (current_sz > capacity) current_sz = capacity;
 
+        // Ҷѯÿɨֻһ
+        float q_inv_norm = (inv_norms != nullptr) ? compute_inv_norm(query, dim) : 1.0f;
+
+        if (filter != nullptr && !filter->empty()) {
+            static thread_local std::vector<uint64_t> match;
+            size_t words = AtomicBitset::word_count(current_sz);
+            match.resize(words);
+            uint32_t tag_mask = filter->tag_mask();
+            filter_bitmap_func(tags, labels, current_sz, filter->tag & tag_mask, tag_mask,
+                               filter->all_labels, filter->any_labels, match.data());
+            for (size_t w = 0; w < words; ++w) {
+                uint64_t bits = match[w] & ~deleted.word(w);
+                while (bits != 0) {
+                    size_t i = w * 64 + (size_t)__builtin_ctzll(bits);
+                    bits &= bits - 1;
+                    score_slot(i, query, q_inv_norm, k, top_candidates, latest_seq);
+                }
+            }
+            return;
+        }
+
         for (size_t i = 0; i < current_sz; ++i) {
-            // ֱӵ AVX2 ӣ data  32 ֽڶģü죡
-            float d = l2_distance_avx2(query, data + i * dim, dim);
-            
-            if (top_candidates.size() < (size_t)k || d < top_candidates.top().dist) {
-                top_candidates.push({ids[i], d});
-                if (top_candidates.size() > (size_t)k) {
-                    top_candidates.pop();
+            if (deleted.test(i)) continue;
+            score_slot(i, query, q_inv_norm, k, top_candidates, latest_seq);
+        }
+    }
+
+    //  i λֲԷŽ
+    inline void score_slot(size_t i, const float* query, float q_inv_norm, int k,
+                           std::priority_queue<NodeDist>& top_candidates,
+                           const std::atomic<uint64_t>* latest_seq) const {
+        // ֱӵ÷ַõ SIMD ӣ data  32 ֽڶģü죡
+        float d = (half_data != nullptr) ? half_dist_func(query, half_data + i * dim, dim)
+                                         : dist_func(query, data + i * dim, dim);
+        if (inv_norms != nullptr) {
+            d = cosine_from_ip_distance(d, q_inv_norm, inv_norms[i]);
+        }
+
+        if (top_candidates.size() < (size_t)k || d < top_candidates.top().dist) {
+            if (is_stale(i, latest_seq)) return;
+            top_candidates.push({ids[i], d});
+            if (top_candidates.size() > (size_t)k) {
+                top_candidates.pop();
+            }
+        }
+    }
+
+    // ѯһڴɨ衿
+    //  L2 װµĴС Buffer гֿ飬ÿֿ DRAM һΣ
+    //  L2 ʱ÷ֿں˰ѯ꣺L2 չ ||q||^2 + ||x||^2 - 2<q, x>
+    // ˷ǻõġnq ѯɨô nq 齵 1 顣
+    // queries Ϊ nq x dim top_candidates Ϊ nq ѡ뾫ȴ洢˻Ϊѯɨ
+    void search_brute_force_batch(const float* queries, size_t nq, int k,
+                                  std::priority_queue<NodeDist>* top_candidates,
+                                  const std::atomic<uint64_t>* latest_seq = nullptr) const {
+        if (half_data != nullptr || nq == 1) {
+            for (size_t qi = 0; qi < nq; ++qi) {
+                search_brute_force(queries + qi * dim, k, top_candidates[qi], latest_seq);
+            }
+            return;
+        }
+
+        size_t current_sz = count.load(std::memory_order_acquire);
+        if (current_sz > capacity) current_sz = capacity;
+        if (current_sz == 0) return;
+
+        // ѯ˵ķÿֻһ
+        std::vector<float> q_norms(nq);
+        for (size_t qi = 0; qi < nq; ++qi) {
+            const float* q = queries + qi * dim;
+            q_norms[qi] = (metric == MetricType::L2) ? compute_sq_norm(q, dim)
+                        : (metric == MetricType::Cosine) ? compute_inv_norm(q, dim) : 1.0f;
+        }
+
+        // ֿԼռ 256KB L2 һ룩ѯÿȡ kQueryBlock ݴ L1/L2
+        static constexpr size_t kTileBytes = 256 * 1024;
+        static constexpr size_t kQueryBlock = 16;
+        size_t tile_vecs = std::max<size_t>(16, kTileBytes / (dim * sizeof(float)));
+        BlockDotFunc block_dot = get_block_dot_func();
+        std::vector<float> dots(kQueryBlock * tile_vecs);
+
+        for (size_t start = 0; start < current_sz; start += tile_vecs) {
+            size_t nv = std::min(tile_vecs, current_sz - start);
+            const float* tile = data + start * dim;
+
+            for (size_t q0 = 0; q0 < nq; q0 += kQueryBlock) {
+                size_t qn = std::min(kQueryBlock, nq - q0);
+                block_dot(queries + q0 * dim, qn, tile, nv, dim, dots.data());
+
+                for (size_t r = 0; r < qn; ++r) {
+                    std::priority_queue<NodeDist>& top = top_candidates[q0 + r];
+                    const float* row = dots.data() + r * nv;
+                    float q_norm = q_norms[q0 + r];
+                    for (size_t j = 0; j < nv; ++j) {
+                        if (deleted.test(start + j)) continue;
+                        float d;
+                        if (metric == MetricType::L2) {
+                            // չʽеĵ΢Сص 0
+                            d = std::max(0.0f, q_norm + sq_norms[start + j] - 2.0f * row[j]);
+                        } else if (metric == MetricType::Cosine) {
+                            d = 1.0f - row[j] * q_norm * inv_norms[start + j];
+                        } else {
+                            d = 1.0f - row[j];
+                        }
+
+                        if (top.size() < (size_t)k || d < top.top().dist) {
+                            if (is_stale(start + j, latest_seq)) continue;
+                            top.push({ids[start + j], d});
+                            if (top.size() > (size_t)k) {
+                                top.pop();
+                            }
+                        }
+                    }
                 }
             }
         }
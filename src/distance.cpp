@@ -1,6 +1,18 @@
 #include "distance.h"
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstring>
 #include <immintrin.h> // Intel AVX ָͷļ
 
+// ȫֱѡٴ -mavx2/-mfmaں target Եָ
+// ϻֻҪַͲִеǷָ
+#define VS_TARGET_SSE    __attribute__((target("sse2")))
+#define VS_TARGET_AVX2   __attribute__((target("avx2,fma")))
+#define VS_TARGET_AVX512 __attribute__((target("avx512f")))
+#define VS_TARGET_F16C   __attribute__((target("avx2,fma,f16c")))
+#define VS_TARGET_POPCNT __attribute__((target("popcnt")))
+
 namespace vector_search {
 
 float l2_distance_scalar(const float* a, const float* b, size_t dim) {
@@ -12,6 +24,32 @@ float l2_distance_scalar(const float* a, const float* b, size_t dim) {
     return sum;
 }
 
+VS_TARGET_SSE
+float l2_distance_sse(const float* a, const float* b, size_t dim) {
+    __m128 sum_vec = _mm_setzero_ps();
+
+    size_t i = 0;
+    // ÿδ 4  float (128 bits)SSE û FMAֻܳ˼ӷֿ
+    for (; i + 3 < dim; i += 4) {
+        __m128 diff = _mm_sub_ps(_mm_loadu_ps(a + i), _mm_loadu_ps(b + i));
+        sum_vec = _mm_add_ps(sum_vec, _mm_mul_ps(diff, diff));
+    }
+
+    // Ĵˮƽ
+    __m128 shuf = _mm_shuffle_ps(sum_vec, sum_vec, _MM_SHUFFLE(2, 3, 0, 1));
+    __m128 sums = _mm_add_ps(sum_vec, shuf);
+    shuf = _mm_movehl_ps(shuf, sums);
+    sums = _mm_add_ss(sums, shuf);
+    float res = _mm_cvtss_f32(sums);
+
+    for (; i < dim; ++i) {
+        float diff = a[i] - b[i];
+        res += diff * diff;
+    }
+    return res;
+}
+
+VS_TARGET_AVX2
 float l2_distance_avx2(const float* a, const float* b, size_t dim) {
     __m256 sum_vec = _mm256_setzero_ps(); // ʼһȫ 0  256 λĴ ( 8  float)
     
@@ -39,4 +77,1153 @@ float l2_distance_avx2(const float* a, const float* b, size_t dim) {
     return res;
 }
 
-} // namespace vector_search
\ No newline at end of file
+VS_TARGET_AVX512
+float l2_distance_avx512(const float* a, const float* b, size_t dim) {
+    // ۼڸ FMA ˮӳ
+    __m512 sum0 = _mm512_setzero_ps();
+    __m512 sum1 = _mm512_setzero_ps();
+
+    size_t i = 0;
+    for (; i + 31 < dim; i += 32) {
+        __m512 d0 = _mm512_sub_ps(_mm512_loadu_ps(a + i), _mm512_loadu_ps(b + i));
+        __m512 d1 = _mm512_sub_ps(_mm512_loadu_ps(a + i + 16), _mm512_loadu_ps(b + i + 16));
+        sum0 = _mm512_fmadd_ps(d0, d0, sum0);
+        sum1 = _mm512_fmadd_ps(d1, d1, sum1);
+    }
+    for (; i + 15 < dim; i += 16) {
+        __m512 d = _mm512_sub_ps(_mm512_loadu_ps(a + i), _mm512_loadu_ps(b + i));
+        sum0 = _mm512_fmadd_ps(d, d, sum0);
+    }
+    // β 16 ʱأԽ粿ֶΪ 0ᴥȱҳ
+    if (i < dim) {
+        __mmask16 mask = (__mmask16)((1u << (dim - i)) - 1u);
+        __m512 d = _mm512_sub_ps(_mm512_maskz_loadu_ps(mask, a + i), _mm512_maskz_loadu_ps(mask, b + i));
+        sum1 = _mm512_fmadd_ps(d, d, sum1);
+    }
+
+    return _mm512_reduce_add_ps(_mm512_add_ps(sum0, sum1));
+}
+
+float inner_product_distance_scalar(const float* a, const float* b, size_t dim) {
+    float dot = 0.0f;
+    for (size_t i = 0; i < dim; ++i) {
+        dot += a[i] * b[i];
+    }
+    return 1.0f - dot;
+}
+
+VS_TARGET_SSE
+float inner_product_distance_sse(const float* a, const float* b, size_t dim) {
+    __m128 sum_vec = _mm_setzero_ps();
+
+    size_t i = 0;
+    for (; i + 3 < dim; i += 4) {
+        sum_vec = _mm_add_ps(sum_vec, _mm_mul_ps(_mm_loadu_ps(a + i), _mm_loadu_ps(b + i)));
+    }
+
+    __m128 shuf = _mm_shuffle_ps(sum_vec, sum_vec, _MM_SHUFFLE(2, 3, 0, 1));
+    __m128 sums = _mm_add_ps(sum_vec, shuf);
+    shuf = _mm_movehl_ps(shuf, sums);
+    sums = _mm_add_ss(sums, shuf);
+    float dot = _mm_cvtss_f32(sums);
+
+    for (; i < dim; ++i) {
+        dot += a[i] * b[i];
+    }
+    return 1.0f - dot;
+}
+
+VS_TARGET_AVX2
+float inner_product_distance_avx2(const float* a, const float* b, size_t dim) {
+    __m256 sum_vec = _mm256_setzero_ps();
+
+    size_t i = 0;
+    for (; i + 7 < dim; i += 8) {
+        // ڻֻһ FMAsum_vec = a * b + sum_vec
+        sum_vec = _mm256_fmadd_ps(_mm256_loadu_ps(a + i), _mm256_loadu_ps(b + i), sum_vec);
+    }
+
+    // 256 λ۰ 128 λڼĴˮƽ
+    __m128 sum128 = _mm_add_ps(_mm256_castps256_ps128(sum_vec), _mm256_extractf128_ps(sum_vec, 1));
+    __m128 shuf = _mm_shuffle_ps(sum128, sum128, _MM_SHUFFLE(2, 3, 0, 1));
+    __m128 sums = _mm_add_ps(sum128, shuf);
+    shuf = _mm_movehl_ps(shuf, sums);
+    sums = _mm_add_ss(sums, shuf);
+    float dot = _mm_cvtss_f32(sums);
+
+    for (; i < dim; ++i) {
+        dot += a[i] * b[i];
+    }
+    return 1.0f - dot;
+}
+
+VS_TARGET_AVX512
+float inner_product_distance_avx512(const float* a, const float* b, size_t dim) {
+    __m512 sum0 = _mm512_setzero_ps();
+    __m512 sum1 = _mm512_setzero_ps();
+
+    size_t i = 0;
+    for (; i + 31 < dim; i += 32) {
+        sum0 = _mm512_fmadd_ps(_mm512_loadu_ps(a + i), _mm512_loadu_ps(b + i), sum0);
+        sum1 = _mm512_fmadd_ps(_mm512_loadu_ps(a + i + 16), _mm512_loadu_ps(b + i + 16), sum1);
+    }
+    for (; i + 15 < dim; i += 16) {
+        sum0 = _mm512_fmadd_ps(_mm512_loadu_ps(a + i), _mm512_loadu_ps(b + i), sum0);
+    }
+    if (i < dim) {
+        __mmask16 mask = (__mmask16)((1u << (dim - i)) - 1u);
+        sum1 = _mm512_fmadd_ps(_mm512_maskz_loadu_ps(mask, a + i), _mm512_maskz_loadu_ps(mask, b + i), sum1);
+    }
+
+    return 1.0f - _mm512_reduce_add_ps(_mm512_add_ps(sum0, sum1));
+}
+
+float compute_inv_norm(const float* v, size_t dim) {
+    // ֻڲÿβѯʼʱһΣ·ϣñ漴
+    float sq = 0.0f;
+    for (size_t i = 0; i < dim; ++i) {
+        sq += v[i] * v[i];
+    }
+    return sq > 0.0f ? 1.0f / std::sqrt(sq) : 0.0f;
+}
+
+float compute_sq_norm(const float* v, size_t dim) {
+    float sq = 0.0f;
+    for (size_t i = 0; i < dim; ++i) {
+        sq += v[i] * v[i];
+    }
+    return sq;
+}
+
+// ==========================================
+// άػںˣάǱڳѭȫչ
+// 4 ۼڸ FMA ӳ٣ҳάȶ 64 ıûβѭ
+// ==========================================
+#define VS_INLINE inline __attribute__((always_inline))
+
+VS_TARGET_AVX2 VS_INLINE
+float hsum_avx2(__m256 v) {
+    __m128 sum128 = _mm_add_ps(_mm256_castps256_ps128(v), _mm256_extractf128_ps(v, 1));
+    __m128 shuf = _mm_shuffle_ps(sum128, sum128, _MM_SHUFFLE(2, 3, 0, 1));
+    __m128 sums = _mm_add_ps(sum128, shuf);
+    shuf = _mm_movehl_ps(shuf, sums);
+    sums = _mm_add_ss(sums, shuf);
+    return _mm_cvtss_f32(sums);
+}
+
+template <size_t D>
+VS_TARGET_AVX2
+float l2_distance_avx2_dim(const float* a, const float* b, size_t) {
+    static_assert(D % 32 == 0, "AVX2 specialized kernel needs dim % 32 == 0");
+    __m256 acc0 = _mm256_setzero_ps(), acc1 = _mm256_setzero_ps();
+    __m256 acc2 = _mm256_setzero_ps(), acc3 = _mm256_setzero_ps();
+#pragma GCC unroll 64
+    for (size_t i = 0; i < D; i += 32) {
+        __m256 d0 = _mm256_sub_ps(_mm256_loadu_ps(a + i), _mm256_loadu_ps(b + i));
+        __m256 d1 = _mm256_sub_ps(_mm256_loadu_ps(a + i + 8), _mm256_loadu_ps(b + i + 8));
+        __m256 d2 = _mm256_sub_ps(_mm256_loadu_ps(a + i + 16), _mm256_loadu_ps(b + i + 16));
+        __m256 d3 = _mm256_sub_ps(_mm256_loadu_ps(a + i + 24), _mm256_loadu_ps(b + i + 24));
+        acc0 = _mm256_fmadd_ps(d0, d0, acc0);
+        acc1 = _mm256_fmadd_ps(d1, d1, acc1);
+        acc2 = _mm256_fmadd_ps(d2, d2, acc2);
+        acc3 = _mm256_fmadd_ps(d3, d3, acc3);
+    }
+    return hsum_avx2(_mm256_add_ps(_mm256_add_ps(acc0, acc1), _mm256_add_ps(acc2, acc3)));
+}
+
+template <size_t D>
+VS_TARGET_AVX2
+float inner_product_distance_avx2_dim(const float* a, const float* b, size_t) {
+    static_assert(D % 32 == 0, "AVX2 specialized kernel needs dim % 32 == 0");
+    __m256 acc0 = _mm256_setzero_ps(), acc1 = _mm256_setzero_ps();
+    __m256 acc2 = _mm256_setzero_ps(), acc3 = _mm256_setzero_ps();
+#pragma GCC unroll 64
+    for (size_t i = 0; i < D; i += 32) {
+        acc0 = _mm256_fmadd_ps(_mm256_loadu_ps(a + i), _mm256_loadu_ps(b + i), acc0);
+        acc1 = _mm256_fmadd_ps(_mm256_loadu_ps(a + i + 8), _mm256_loadu_ps(b + i + 8), acc1);
+        acc2 = _mm256_fmadd_ps(_mm256_loadu_ps(a + i + 16), _mm256_loadu_ps(b + i + 16), acc2);
+        acc3 = _mm256_fmadd_ps(_mm256_loadu_ps(a + i + 24), _mm256_loadu_ps(b + i + 24), acc3);
+    }
+    return 1.0f - hsum_avx2(_mm256_add_ps(_mm256_add_ps(acc0, acc1), _mm256_add_ps(acc2, acc3)));
+}
+
+template <size_t D>
+VS_TARGET_AVX512
+float l2_distance_avx512_dim(const float* a, const float* b, size_t) {
+    static_assert(D % 64 == 0, "AVX-512 specialized kernel needs dim % 64 == 0");
+    __m512 acc0 = _mm512_setzero_ps(), acc1 = _mm512_setzero_ps();
+    __m512 acc2 = _mm512_setzero_ps(), acc3 = _mm512_setzero_ps();
+#pragma GCC unroll 64
+    for (size_t i = 0; i < D; i += 64) {
+        __m512 d0 = _mm512_sub_ps(_mm512_loadu_ps(a + i), _mm512_loadu_ps(b + i));
+        __m512 d1 = _mm512_sub_ps(_mm512_loadu_ps(a + i + 16), _mm512_loadu_ps(b + i + 16));
+        __m512 d2 = _mm512_sub_ps(_mm512_loadu_ps(a + i + 32), _mm512_loadu_ps(b + i + 32));
+        __m512 d3 = _mm512_sub_ps(_mm512_loadu_ps(a + i + 48), _mm512_loadu_ps(b + i + 48));
+        acc0 = _mm512_fmadd_ps(d0, d0, acc0);
+        acc1 = _mm512_fmadd_ps(d1, d1, acc1);
+        acc2 = _mm512_fmadd_ps(d2, d2, acc2);
+        acc3 = _mm512_fmadd_ps(d3, d3, acc3);
+    }
+    return _mm512_reduce_add_ps(_mm512_add_ps(_mm512_add_ps(acc0, acc1), _mm512_add_ps(acc2, acc3)));
+}
+
+template <size_t D>
+VS_TARGET_AVX512
+float inner_product_distance_avx512_dim(const float* a, const float* b, size_t) {
+    static_assert(D % 64 == 0, "AVX-512 specialized kernel needs dim % 64 == 0");
+    __m512 acc0 = _mm512_setzero_ps(), acc1 = _mm512_setzero_ps();
+    __m512 acc2 = _mm512_setzero_ps(), acc3 = _mm512_setzero_ps();
+#pragma GCC unroll 64
+    for (size_t i = 0; i < D; i += 64) {
+        acc0 = _mm512_fmadd_ps(_mm512_loadu_ps(a + i), _mm512_loadu_ps(b + i), acc0);
+        acc1 = _mm512_fmadd_ps(_mm512_loadu_ps(a + i + 16), _mm512_loadu_ps(b + i + 16), acc1);
+        acc2 = _mm512_fmadd_ps(_mm512_loadu_ps(a + i + 32), _mm512_loadu_ps(b + i + 32), acc2);
+        acc3 = _mm512_fmadd_ps(_mm512_loadu_ps(a + i + 48), _mm512_loadu_ps(b + i + 48), acc3);
+    }
+    return 1.0f - _mm512_reduce_add_ps(_mm512_add_ps(_mm512_add_ps(acc0, acc1), _mm512_add_ps(acc2, acc3)));
+}
+
+// ά -> ػں˵Ĳάֻһ
+#define VS_FIXED_DIM_CASES(KERNEL)      \
+    case 128: return KERNEL<128>;       \
+    case 256: return KERNEL<256>;       \
+    case 384: return KERNEL<384>;       \
+    case 768: return KERNEL<768>;       \
+    case 1024: return KERNEL<1024>;     \
+    case 1536: return KERNEL<1536>;
+
+DistanceFunc get_fixed_dim_distance_func(MetricType metric, SimdLevel level, size_t dim) {
+    bool l2 = (metric == MetricType::L2);
+    if (level == SimdLevel::AVX512) {
+        if (l2) {
+            switch (dim) { VS_FIXED_DIM_CASES(l2_distance_avx512_dim) default: return nullptr; }
+        }
+        switch (dim) { VS_FIXED_DIM_CASES(inner_product_distance_avx512_dim) default: return nullptr; }
+    }
+    if (level == SimdLevel::AVX2) {
+        if (l2) {
+            switch (dim) { VS_FIXED_DIM_CASES(l2_distance_avx2_dim) default: return nullptr; }
+        }
+        switch (dim) { VS_FIXED_DIM_CASES(inner_product_distance_avx2_dim) default: return nullptr; }
+    }
+    return nullptr;
+}
+
+// ==========================================
+// һԶںˣһѯһַɢĺѡͼһ
+// ÿν 4 ѡѯÿֻֿһΣڼĴ 4 ѡã
+// 4 ·ļڸǷôӳ٣ͬʱ˳ԤȡһѡͬһƫƴĻ
+// ==========================================
+
+// 4 ۼһˮƽͣΪ [sum(a0), sum(a1), sum(a2), sum(a3)]
+VS_TARGET_AVX2 VS_INLINE
+__m128 hsum4_avx2(__m256 a0, __m256 a1, __m256 a2, __m256 a3) {
+    __m256 t0 = _mm256_hadd_ps(a0, a1);
+    __m256 t1 = _mm256_hadd_ps(a2, a3);
+    __m256 t = _mm256_hadd_ps(t0, t1);
+    return _mm_add_ps(_mm256_castps256_ps128(t), _mm256_extractf128_ps(t, 1));
+}
+
+template <bool kL2>
+VS_TARGET_AVX2
+void batch_distance_avx2(const float* query, const float* const* vecs, size_t n, size_t dim, float* out) {
+    size_t j = 0;
+    for (; j + 3 < n; j += 4) {
+        const float* x0 = vecs[j];
+        const float* x1 = vecs[j + 1];
+        const float* x2 = vecs[j + 2];
+        const float* x3 = vecs[j + 3];
+        // ûһʱԤȡǰԼڻУ޸ãʡѭķ֧
+        const float* p0 = (j + 4 < n) ? vecs[j + 4] : x0;
+        const float* p1 = (j + 5 < n) ? vecs[j + 5] : x1;
+        const float* p2 = (j + 6 < n) ? vecs[j + 6] : x2;
+        const float* p3 = (j + 7 < n) ? vecs[j + 7] : x3;
+
+        __m256 acc0 = _mm256_setzero_ps(), acc1 = _mm256_setzero_ps();
+        __m256 acc2 = _mm256_setzero_ps(), acc3 = _mm256_setzero_ps();
+        size_t i = 0;
+        for (; i + 7 < dim; i += 8) {
+            if ((i & 15) == 0) { // ÿ 64 ֽһ
+                _mm_prefetch((const char*)(p0 + i), _MM_HINT_T0);
+                _mm_prefetch((const char*)(p1 + i), _MM_HINT_T0);
+                _mm_prefetch((const char*)(p2 + i), _MM_HINT_T0);
+                _mm_prefetch((const char*)(p3 + i), _MM_HINT_T0);
+            }
+            __m256 q = _mm256_loadu_ps(query + i);
+            if (kL2) {
+                __m256 d0 = _mm256_sub_ps(_mm256_loadu_ps(x0 + i), q);
+                __m256 d1 = _mm256_sub_ps(_mm256_loadu_ps(x1 + i), q);
+                __m256 d2 = _mm256_sub_ps(_mm256_loadu_ps(x2 + i), q);
+                __m256 d3 = _mm256_sub_ps(_mm256_loadu_ps(x3 + i), q);
+                acc0 = _mm256_fmadd_ps(d0, d0, acc0);
+                acc1 = _mm256_fmadd_ps(d1, d1, acc1);
+                acc2 = _mm256_fmadd_ps(d2, d2, acc2);
+                acc3 = _mm256_fmadd_ps(d3, d3, acc3);
+            } else {
+                acc0 = _mm256_fmadd_ps(_mm256_loadu_ps(x0 + i), q, acc0);
+                acc1 = _mm256_fmadd_ps(_mm256_loadu_ps(x1 + i), q, acc1);
+                acc2 = _mm256_fmadd_ps(_mm256_loadu_ps(x2 + i), q, acc2);
+                acc3 = _mm256_fmadd_ps(_mm256_loadu_ps(x3 + i), q, acc3);
+            }
+        }
+        __m128 sums = hsum4_avx2(acc0, acc1, acc2, acc3);
+
+        // άȲ 8 ıʱβ
+        if (i < dim) {
+            float t[4] = {0.0f, 0.0f, 0.0f, 0.0f};
+            for (; i < dim; ++i) {
+                if (kL2) {
+                    float d0 = x0[i] - query[i], d1 = x1[i] - query[i];
+                    float d2 = x2[i] - query[i], d3 = x3[i] - query[i];
+                    t[0] += d0 * d0; t[1] += d1 * d1; t[2] += d2 * d2; t[3] += d3 * d3;
+                } else {
+                    t[0] += x0[i] * query[i]; t[1] += x1[i] * query[i];
+                    t[2] += x2[i] * query[i]; t[3] += x3[i] * query[i];
+                }
+            }
+            sums = _mm_add_ps(sums, _mm_loadu_ps(t));
+        }
+        if (!kL2) sums = _mm_sub_ps(_mm_set1_ps(1.0f), sums);
+        _mm_storeu_ps(out + j, sums);
+    }
+    for (; j < n; ++j) {
+        out[j] = kL2 ? l2_distance_avx2(query, vecs[j], dim) : inner_product_distance_avx2(query, vecs[j], dim);
+    }
+}
+
+template <bool kL2>
+VS_TARGET_AVX512
+void batch_distance_avx512(const float* query, const float* const* vecs, size_t n, size_t dim, float* out) {
+    size_t j = 0;
+    for (; j + 3 < n; j += 4) {
+        const float* x0 = vecs[j];
+        const float* x1 = vecs[j + 1];
+        const float* x2 = vecs[j + 2];
+        const float* x3 = vecs[j + 3];
+        const float* p0 = (j + 4 < n) ? vecs[j + 4] : x0;
+        const float* p1 = (j + 5 < n) ? vecs[j + 5] : x1;
+        const float* p2 = (j + 6 < n) ? vecs[j + 6] : x2;
+        const float* p3 = (j + 7 < n) ? vecs[j + 7] : x3;
+
+        __m512 acc0 = _mm512_setzero_ps(), acc1 = _mm512_setzero_ps();
+        __m512 acc2 = _mm512_setzero_ps(), acc3 = _mm512_setzero_ps();
+        // 16  float һУÿԤȡһУβ
+        for (size_t i = 0; i < dim; i += 16) {
+            __mmask16 mask = (dim - i >= 16) ? (__mmask16)0xFFFF : (__mmask16)((1u << (dim - i)) - 1u);
+            _mm_prefetch((const char*)(p0 + i), _MM_HINT_T0);
+            _mm_prefetch((const char*)(p1 + i), _MM_HINT_T0);
+            _mm_prefetch((const char*)(p2 + i), _MM_HINT_T0);
+            _mm_prefetch((const char*)(p3 + i), _MM_HINT_T0);
+            __m512 q = _mm512_maskz_loadu_ps(mask, query + i);
+            if (kL2) {
+                __m512 d0 = _mm512_sub_ps(_mm512_maskz_loadu_ps(mask, x0 + i), q);
+                __m512 d1 = _mm512_sub_ps(_mm512_maskz_loadu_ps(mask, x1 + i), q);
+                __m512 d2 = _mm512_sub_ps(_mm512_maskz_loadu_ps(mask, x2 + i), q);
+                __m512 d3 = _mm512_sub_ps(_mm512_maskz_loadu_ps(mask, x3 + i), q);
+                acc0 = _mm512_fmadd_ps(d0, d0, acc0);
+                acc1 = _mm512_fmadd_ps(d1, d1, acc1);
+                acc2 = _mm512_fmadd_ps(d2, d2, acc2);
+                acc3 = _mm512_fmadd_ps(d3, d3, acc3);
+            } else {
+                acc0 = _mm512_fmadd_ps(_mm512_maskz_loadu_ps(mask, x0 + i), q, acc0);
+                acc1 = _mm512_fmadd_ps(_mm512_maskz_loadu_ps(mask, x1 + i), q, acc1);
+                acc2 = _mm512_fmadd_ps(_mm512_maskz_loadu_ps(mask, x2 + i), q, acc2);
+                acc3 = _mm512_fmadd_ps(_mm512_maskz_loadu_ps(mask, x3 + i), q, acc3);
+            }
+        }
+        float s0 = _mm512_reduce_add_ps(acc0), s1 = _mm512_reduce_add_ps(acc1);
+        float s2 = _mm512_reduce_add_ps(acc2), s3 = _mm512_reduce_add_ps(acc3);
+        out[j] = kL2 ? s0 : 1.0f - s0;
+        out[j + 1] = kL2 ? s1 : 1.0f - s1;
+        out[j + 2] = kL2 ? s2 : 1.0f - s2;
+        out[j + 3] = kL2 ? s3 : 1.0f - s3;
+    }
+    for (; j < n; ++j) {
+        out[j] = kL2 ? l2_distance_avx512(query, vecs[j], dim) : inner_product_distance_avx512(query, vecs[j], dim);
+    }
+}
+
+// άػһԶںˣͨð汾ͬ 4 ·Ԥȡһ飬άǱڳ
+// ڲѭȫչûβղ 4 ͬάȵĵԵػں
+template <bool kL2, size_t D>
+VS_TARGET_AVX2
+void batch_distance_avx2_dim(const float* query, const float* const* vecs, size_t n, size_t, float* out) {
+    static_assert(D % 32 == 0, "AVX2 specialized kernel needs dim % 32 == 0");
+    size_t j = 0;
+    for (; j + 3 < n; j += 4) {
+        const float* x0 = vecs[j];
+        const float* x1 = vecs[j + 1];
+        const float* x2 = vecs[j + 2];
+        const float* x3 = vecs[j + 3];
+        const float* p0 = (j + 4 < n) ? vecs[j + 4] : x0;
+        const float* p1 = (j + 5 < n) ? vecs[j + 5] : x1;
+        const float* p2 = (j + 6 < n) ? vecs[j + 6] : x2;
+        const float* p3 = (j + 7 < n) ? vecs[j + 7] : x3;
+
+        __m256 acc0 = _mm256_setzero_ps(), acc1 = _mm256_setzero_ps();
+        __m256 acc2 = _mm256_setzero_ps(), acc3 = _mm256_setzero_ps();
+#pragma GCC unroll 64
+        for (size_t i = 0; i < D; i += 16) {
+            _mm_prefetch((const char*)(p0 + i), _MM_HINT_T0);
+            _mm_prefetch((const char*)(p1 + i), _MM_HINT_T0);
+            _mm_prefetch((const char*)(p2 + i), _MM_HINT_T0);
+            _mm_prefetch((const char*)(p3 + i), _MM_HINT_T0);
+            __m256 qa = _mm256_loadu_ps(query + i);
+            __m256 qb = _mm256_loadu_ps(query + i + 8);
+            if (kL2) {
+                __m256 d0 = _mm256_sub_ps(_mm256_loadu_ps(x0 + i), qa);
+                __m256 d1 = _mm256_sub_ps(_mm256_loadu_ps(x1 + i), qa);
+                __m256 d2 = _mm256_sub_ps(_mm256_loadu_ps(x2 + i), qa);
+                __m256 d3 = _mm256_sub_ps(_mm256_loadu_ps(x3 + i), qa);
+                acc0 = _mm256_fmadd_ps(d0, d0, acc0);
+                acc1 = _mm256_fmadd_ps(d1, d1, acc1);
+                acc2 = _mm256_fmadd_ps(d2, d2, acc2);
+                acc3 = _mm256_fmadd_ps(d3, d3, acc3);
+                d0 = _mm256_sub_ps(_mm256_loadu_ps(x0 + i + 8), qb);
+                d1 = _mm256_sub_ps(_mm256_loadu_ps(x1 + i + 8), qb);
+                d2 = _mm256_sub_ps(_mm256_loadu_ps(x2 + i + 8), qb);
+                d3 = _mm256_sub_ps(_mm256_loadu_ps(x3 + i + 8), qb);
+                acc0 = _mm256_fmadd_ps(d0, d0, acc0);
+                acc1 = _mm256_fmadd_ps(d1, d1, acc1);
+                acc2 = _mm256_fmadd_ps(d2, d2, acc2);
+                acc3 = _mm256_fmadd_ps(d3, d3, acc3);
+            } else {
+                acc0 = _mm256_fmadd_ps(_mm256_loadu_ps(x0 + i), qa, acc0);
+                acc1 = _mm256_fmadd_ps(_mm256_loadu_ps(x1 + i), qa, acc1);
+                acc2 = _mm256_fmadd_ps(_mm256_loadu_ps(x2 + i), qa, acc2);
+                acc3 = _mm256_fmadd_ps(_mm256_loadu_ps(x3 + i), qa, acc3);
+                acc0 = _mm256_fmadd_ps(_mm256_loadu_ps(x0 + i + 8), qb, acc0);
+                acc1 = _mm256_fmadd_ps(_mm256_loadu_ps(x1 + i + 8), qb, acc1);
+                acc2 = _mm256_fmadd_ps(_mm256_loadu_ps(x2 + i + 8), qb, acc2);
+                acc3 = _mm256_fmadd_ps(_mm256_loadu_ps(x3 + i + 8), qb, acc3);
+            }
+        }
+        __m128 sums = hsum4_avx2(acc0, acc1, acc2, acc3);
+        if (!kL2) sums = _mm_sub_ps(_mm_set1_ps(1.0f), sums);
+        _mm_storeu_ps(out + j, sums);
+    }
+    for (; j < n; ++j) {
+        out[j] = kL2 ? l2_distance_avx2_dim<D>(query, vecs[j], D) : inner_product_distance_avx2_dim<D>(query, vecs[j], D);
+    }
+}
+
+template <bool kL2, size_t D>
+VS_TARGET_AVX512
+void batch_distance_avx512_dim(const float* query, const float* const* vecs, size_t n, size_t, float* out) {
+    static_assert(D % 64 == 0, "AVX-512 specialized kernel needs dim % 64 == 0");
+    size_t j = 0;
+    for (; j + 3 < n; j += 4) {
+        const float* x0 = vecs[j];
+        const float* x1 = vecs[j + 1];
+        const float* x2 = vecs[j + 2];
+        const float* x3 = vecs[j + 3];
+        const float* p0 = (j + 4 < n) ? vecs[j + 4] : x0;
+        const float* p1 = (j + 5 < n) ? vecs[j + 5] : x1;
+        const float* p2 = (j + 6 < n) ? vecs[j + 6] : x2;
+        const float* p3 = (j + 7 < n) ? vecs[j + 7] : x3;
+
+        __m512 acc0 = _mm512_setzero_ps(), acc1 = _mm512_setzero_ps();
+        __m512 acc2 = _mm512_setzero_ps(), acc3 = _mm512_setzero_ps();
+#pragma GCC unroll 64
+        for (size_t i = 0; i < D; i += 16) {
+            _mm_prefetch((const char*)(p0 + i), _MM_HINT_T0);
+            _mm_prefetch((const char*)(p1 + i), _MM_HINT_T0);
+            _mm_prefetch((const char*)(p2 + i), _MM_HINT_T0);
+            _mm_prefetch((const char*)(p3 + i), _MM_HINT_T0);
+            __m512 q = _mm512_loadu_ps(query + i);
+            if (kL2) {
+                __m512 d0 = _mm512_sub_ps(_mm512_loadu_ps(x0 + i), q);
+                __m512 d1 = _mm512_sub_ps(_mm512_loadu_ps(x1 + i), q);
+                __m512 d2 = _mm512_sub_ps(_mm512_loadu_ps(x2 + i), q);
+                __m512 d3 = _mm512_sub_ps(_mm512_loadu_ps(x3 + i), q);
+                acc0 = _mm512_fmadd_ps(d0, d0, acc0);
+                acc1 = _mm512_fmadd_ps(d1, d1, acc1);
+                acc2 = _mm512_fmadd_ps(d2, d2, acc2);
+                acc3 = _mm512_fmadd_ps(d3, d3, acc3);
+            } else {
+                acc0 = _mm512_fmadd_ps(_mm512_loadu_ps(x0 + i), q, acc0);
+                acc1 = _mm512_fmadd_ps(_mm512_loadu_ps(x1 + i), q, acc1);
+                acc2 = _mm512_fmadd_ps(_mm512_loadu_ps(x2 + i), q, acc2);
+                acc3 = _mm512_fmadd_ps(_mm512_loadu_ps(x3 + i), q, acc3);
+            }
+        }
+        float s0 = _mm512_reduce_add_ps(acc0), s1 = _mm512_reduce_add_ps(acc1);
+        float s2 = _mm512_reduce_add_ps(acc2), s3 = _mm512_reduce_add_ps(acc3);
+        out[j] = kL2 ? s0 : 1.0f - s0;
+        out[j + 1] = kL2 ? s1 : 1.0f - s1;
+        out[j + 2] = kL2 ? s2 : 1.0f - s2;
+        out[j + 3] = kL2 ? s3 : 1.0f - s3;
+    }
+    for (; j < n; ++j) {
+        out[j] = kL2 ? l2_distance_avx512_dim<D>(query, vecs[j], D) : inner_product_distance_avx512_dim<D>(query, vecs[j], D);
+    }
+}
+
+// ģػں˲һ̶Ϊ ARG
+#define VS_FIXED_DIM_CASES2(KERNEL, ARG)      \
+    case 128: return KERNEL<ARG, 128>;        \
+    case 256: return KERNEL<ARG, 256>;        \
+    case 384: return KERNEL<ARG, 384>;        \
+    case 768: return KERNEL<ARG, 768>;        \
+    case 1024: return KERNEL<ARG, 1024>;      \
+    case 1536: return KERNEL<ARG, 1536>;
+
+BatchDistanceFunc get_fixed_dim_batch_distance_func(MetricType metric, SimdLevel level, size_t dim) {
+    bool l2 = (metric == MetricType::L2);
+    if (level == SimdLevel::AVX512) {
+        if (l2) {
+            switch (dim) { VS_FIXED_DIM_CASES2(batch_distance_avx512_dim, true) default: return nullptr; }
+        }
+        switch (dim) { VS_FIXED_DIM_CASES2(batch_distance_avx512_dim, false) default: return nullptr; }
+    }
+    if (level == SimdLevel::AVX2) {
+        if (l2) {
+            switch (dim) { VS_FIXED_DIM_CASES2(batch_distance_avx2_dim, true) default: return nullptr; }
+        }
+        switch (dim) { VS_FIXED_DIM_CASES2(batch_distance_avx2_dim, false) default: return nullptr; }
+    }
+    return nullptr;
+}
+
+// û SIMD 汾ļõԵں
+template <DistanceFunc kFunc>
+void batch_distance_single(const float* query, const float* const* vecs, size_t n, size_t dim, float* out) {
+    for (size_t j = 0; j < n; ++j) {
+        out[j] = kFunc(query, vecs[j], dim);
+    }
+}
+
+BatchDistanceFunc get_batch_distance_func(MetricType metric, SimdLevel level) {
+    bool l2 = (metric == MetricType::L2);
+    switch (level) {
+        case SimdLevel::AVX512:
+            return l2 ? batch_distance_avx512<true> : batch_distance_avx512<false>;
+        case SimdLevel::AVX2:
+            return l2 ? batch_distance_avx2<true> : batch_distance_avx2<false>;
+        case SimdLevel::SSE:
+            return l2 ? batch_distance_single<l2_distance_sse> : batch_distance_single<inner_product_distance_sse>;
+        default:
+            return l2 ? batch_distance_single<l2_distance_scalar> : batch_distance_single<inner_product_distance_scalar>;
+    }
+}
+
+BatchDistanceFunc get_batch_distance_func(MetricType metric, size_t dim) {
+    SimdLevel level = detect_simd_level();
+    BatchDistanceFunc fixed = get_fixed_dim_batch_distance_func(metric, level, dim);
+    if (fixed != nullptr) return fixed;
+    return get_batch_distance_func(metric, level);
+}
+
+// ==========================================
+// SQ8 ֮ L2 ں
+// ==========================================
+uint32_t sq8_l2_distance_scalar(const uint8_t* a, const uint8_t* b, size_t dim) {
+    uint32_t sum = 0;
+    for (size_t i = 0; i < dim; ++i) {
+        int32_t diff = (int32_t)a[i] - (int32_t)b[i];
+        sum += (uint32_t)(diff * diff);
+    }
+    return sum;
+}
+
+VS_TARGET_AVX2
+uint32_t sq8_l2_distance_avx2(const uint8_t* a, const uint8_t* b, size_t dim) {
+    //  0~255 ޷ƽ 255^2 vpmaddubsw зŲķΧ
+    //  vpmovzxbw չ 16 λ vpmaddwd һƽ
+    __m256i acc0 = _mm256_setzero_si256();
+    __m256i acc1 = _mm256_setzero_si256();
+
+    size_t i = 0;
+    for (; i + 31 < dim; i += 32) {
+        __m256i va = _mm256_loadu_si256((const __m256i*)(a + i));
+        __m256i vb = _mm256_loadu_si256((const __m256i*)(b + i));
+        __m256i d_lo = _mm256_sub_epi16(_mm256_cvtepu8_epi16(_mm256_castsi256_si128(va)),
+                                        _mm256_cvtepu8_epi16(_mm256_castsi256_si128(vb)));
+        __m256i d_hi = _mm256_sub_epi16(_mm256_cvtepu8_epi16(_mm256_extracti128_si256(va, 1)),
+                                        _mm256_cvtepu8_epi16(_mm256_extracti128_si256(vb, 1)));
+        acc0 = _mm256_add_epi32(acc0, _mm256_madd_epi16(d_lo, d_lo));
+        acc1 = _mm256_add_epi32(acc1, _mm256_madd_epi16(d_hi, d_hi));
+    }
+    for (; i + 15 < dim; i += 16) {
+        __m256i d = _mm256_sub_epi16(_mm256_cvtepu8_epi16(_mm_loadu_si128((const __m128i*)(a + i))),
+                                     _mm256_cvtepu8_epi16(_mm_loadu_si128((const __m128i*)(b + i))));
+        acc0 = _mm256_add_epi32(acc0, _mm256_madd_epi16(d, d));
+    }
+
+    __m256i acc = _mm256_add_epi32(acc0, acc1);
+    __m128i sum128 = _mm_add_epi32(_mm256_castsi256_si128(acc), _mm256_extracti128_si256(acc, 1));
+    sum128 = _mm_add_epi32(sum128, _mm_shuffle_epi32(sum128, _MM_SHUFFLE(1, 0, 3, 2)));
+    sum128 = _mm_add_epi32(sum128, _mm_shuffle_epi32(sum128, _MM_SHUFFLE(2, 3, 0, 1)));
+    uint32_t res = (uint32_t)_mm_cvtsi128_si32(sum128);
+
+    for (; i < dim; ++i) {
+        int32_t diff = (int32_t)a[i] - (int32_t)b[i];
+        res += (uint32_t)(diff * diff);
+    }
+    return res;
+}
+
+Sq8DistanceFunc get_sq8_l2_distance_func(SimdLevel level) {
+    return (level >= SimdLevel::AVX2) ? sq8_l2_distance_avx2 : sq8_l2_distance_scalar;
+}
+
+Sq8DistanceFunc get_sq8_l2_distance_func() {
+    return get_sq8_l2_distance_func(detect_simd_level());
+}
+
+// ==========================================
+// PQ ǶԳƾ (ADC) ں
+// ==========================================
+float pq_adc_distance_scalar(const float* table, const uint8_t* code, size_t m) {
+    // 4 ۼϼӷķôԲз
+    float s0 = 0.0f, s1 = 0.0f, s2 = 0.0f, s3 = 0.0f;
+    size_t i = 0;
+    for (; i + 3 < m; i += 4) {
+        s0 += table[(i + 0) * 256 + code[i + 0]];
+        s1 += table[(i + 1) * 256 + code[i + 1]];
+        s2 += table[(i + 2) * 256 + code[i + 2]];
+        s3 += table[(i + 3) * 256 + code[i + 3]];
+    }
+    for (; i < m; ++i) {
+        s0 += table[i * 256 + code[i]];
+    }
+    return (s0 + s1) + (s2 + s3);
+}
+
+VS_TARGET_AVX2
+float pq_adc_distance_avx2(const float* table, const uint8_t* code, size_t m) {
+    // һδ 8 ӿռ䣺չ 32 λϸӿռʼƫƺ gather
+    const __m256i sub_offsets = _mm256_setr_epi32(0, 256, 512, 768, 1024, 1280, 1536, 1792);
+    __m256 acc = _mm256_setzero_ps();
+
+    size_t i = 0;
+    for (; i + 7 < m; i += 8) {
+        __m256i idx = _mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i*)(code + i)));
+        idx = _mm256_add_epi32(idx, sub_offsets);
+        acc = _mm256_add_ps(acc, _mm256_i32gather_ps(table + i * 256, idx, 4));
+    }
+
+    float res = hsum_avx2(acc);
+    for (; i < m; ++i) {
+        res += table[i * 256 + code[i]];
+    }
+    return res;
+}
+
+PqAdcDistanceFunc get_pq_adc_distance_func(SimdLevel level) {
+    return (level >= SimdLevel::AVX2) ? pq_adc_distance_avx2 : pq_adc_distance_scalar;
+}
+
+PqAdcDistanceFunc get_pq_adc_distance_func() {
+    return get_pq_adc_distance_func(detect_simd_level());
+}
+
+// ==========================================
+// 뾫ȴ洢 (FP16 / BF16)ʱת fp32ۼȫ fp32
+// ==========================================
+static uint16_t fp32_to_fp16_scalar(float f) {
+    uint32_t x;
+    std::memcpy(&x, &f, sizeof(x));
+    uint32_t sign = (x >> 16) & 0x8000;
+    uint32_t exp = (x >> 23) & 0xFF;
+    uint32_t mant = x & 0x7FFFFF;
+    if (exp == 0xFF) return (uint16_t)(sign | 0x7C00 | (mant ? 0x200 : 0)); // Inf / NaN
+    int32_t e = (int32_t)exp - 127 + 15;
+    if (e >= 31) return (uint16_t)(sign | 0x7C00); // Ϊ Inf
+    if (e <= 0) {
+        // ǹ 1 ƣż
+        if (e < -10) return (uint16_t)sign;
+        mant |= 0x800000;
+        uint32_t shift = (uint32_t)(14 - e);
+        uint32_t half = mant >> shift;
+        uint32_t rem = mant & ((1u << shift) - 1);
+        uint32_t halfway = 1u << (shift - 1);
+        if (rem > halfway || (rem == halfway && (half & 1))) half++;
+        return (uint16_t)(sign | half);
+    }
+    uint32_t half = sign | ((uint32_t)e << 10) | (mant >> 13);
+    uint32_t rem = mant & 0x1FFF;
+    // βλȻָλñ Inf
+    if (rem > 0x1000 || (rem == 0x1000 && (half & 1))) half++;
+    return (uint16_t)half;
+}
+
+static float fp16_to_fp32_scalar(uint16_t h) {
+    uint32_t sign = (uint32_t)(h & 0x8000) << 16;
+    uint32_t exp = (h >> 10) & 0x1F;
+    uint32_t mant = h & 0x3FF;
+    uint32_t x;
+    if (exp == 0) {
+        float f = (float)mant * (1.0f / 16777216.0f); // ǹmant * 2^-24
+        std::memcpy(&x, &f, sizeof(x));
+        x |= sign;
+    } else if (exp == 31) {
+        x = sign | 0x7F800000 | (mant << 13);
+    } else {
+        x = sign | ((exp - 15 + 127) << 23) | (mant << 13);
+    }
+    float f;
+    std::memcpy(&f, &x, sizeof(f));
+    return f;
+}
+
+static uint16_t fp32_to_bf16_scalar(float f) {
+    uint32_t x;
+    std::memcpy(&x, &f, sizeof(x));
+    if ((x & 0x7FFFFFFF) > 0x7F800000) return (uint16_t)((x >> 16) | 0x40); //  NaN
+    x += 0x7FFF + ((x >> 16) & 1); // ż
+    return (uint16_t)(x >> 16);
+}
+
+static inline float bf16_to_fp32_scalar(uint16_t h) {
+    uint32_t x = (uint32_t)h << 16;
+    float f;
+    std::memcpy(&f, &x, sizeof(f));
+    return f;
+}
+
+template <bool kBf16>
+static inline float half_to_fp32(uint16_t h) {
+    return kBf16 ? bf16_to_fp32_scalar(h) : fp16_to_fp32_scalar(h);
+}
+
+// F16C ֧ AVX2  x86 CPU ϶ڣԵ̽һԷһ
+static bool cpu_has_f16c() {
+    static const bool has = []() {
+        __builtin_cpu_init();
+        return __builtin_cpu_supports("f16c") != 0;
+    }();
+    return has;
+}
+
+static bool half_avx2_available(SimdLevel level) {
+    return level >= SimdLevel::AVX2 && cpu_has_f16c();
+}
+
+VS_TARGET_F16C
+static void fp32_to_fp16_f16c(const float* src, uint16_t* dst, size_t dim) {
+    size_t i = 0;
+    for (; i + 7 < dim; i += 8) {
+        __m128i h = _mm256_cvtps_ph(_mm256_loadu_ps(src + i), _MM_FROUND_TO_NEAREST_INT);
+        _mm_storeu_si128((__m128i*)(dst + i), h);
+    }
+    for (; i < dim; ++i) dst[i] = fp32_to_fp16_scalar(src[i]);
+}
+
+void encode_half(VectorStorage storage, const float* src, uint16_t* dst, size_t dim) {
+    if (storage == VectorStorage::Float16) {
+        if (half_avx2_available(detect_simd_level())) {
+            fp32_to_fp16_f16c(src, dst, dim);
+            return;
+        }
+        for (size_t i = 0; i < dim; ++i) dst[i] = fp32_to_fp16_scalar(src[i]);
+    } else {
+        for (size_t i = 0; i < dim; ++i) dst[i] = fp32_to_bf16_scalar(src[i]);
+    }
+}
+
+void decode_half(VectorStorage storage, const uint16_t* src, float* dst, size_t dim) {
+    if (storage == VectorStorage::Float16) {
+        for (size_t i = 0; i < dim; ++i) dst[i] = fp16_to_fp32_scalar(src[i]);
+    } else {
+        for (size_t i = 0; i < dim; ++i) dst[i] = bf16_to_fp32_scalar(src[i]);
+    }
+}
+
+template <bool kL2, bool kBf16>
+static float half_distance_scalar(const float* query, const uint16_t* x, size_t dim) {
+    float sum = 0.0f;
+    for (size_t i = 0; i < dim; ++i) {
+        float v = half_to_fp32<kBf16>(x[i]);
+        if (kL2) {
+            float diff = query[i] - v;
+            sum += diff * diff;
+        } else {
+            sum += query[i] * v;
+        }
+    }
+    return kL2 ? sum : 1.0f - sum;
+}
+
+// 8 뾫ת 8  fp32FP16  F16C  vcvtph2ps
+// BF16  fp32 ĸ 16 λչ 32 λ 16 λ
+template <bool kBf16>
+VS_TARGET_F16C VS_INLINE
+__m256 load_half8(const uint16_t* p) {
+    __m128i h = _mm_loadu_si128((const __m128i*)p);
+    if (kBf16) {
+        return _mm256_castsi256_ps(_mm256_slli_epi32(_mm256_cvtepu16_epi32(h), 16));
+    }
+    return _mm256_cvtph_ps(h);
+}
+
+template <bool kL2, bool kBf16>
+VS_TARGET_F16C
+float half_distance_avx2(const float* query, const uint16_t* x, size_t dim) {
+    __m256 acc0 = _mm256_setzero_ps();
+    __m256 acc1 = _mm256_setzero_ps();
+
+    size_t i = 0;
+    for (; i + 15 < dim; i += 16) {
+        __m256 x0 = load_half8<kBf16>(x + i);
+        __m256 x1 = load_half8<kBf16>(x + i + 8);
+        __m256 q0 = _mm256_loadu_ps(query + i);
+        __m256 q1 = _mm256_loadu_ps(query + i + 8);
+        if (kL2) {
+            __m256 d0 = _mm256_sub_ps(q0, x0);
+            __m256 d1 = _mm256_sub_ps(q1, x1);
+            acc0 = _mm256_fmadd_ps(d0, d0, acc0);
+            acc1 = _mm256_fmadd_ps(d1, d1, acc1);
+        } else {
+            acc0 = _mm256_fmadd_ps(q0, x0, acc0);
+            acc1 = _mm256_fmadd_ps(q1, x1, acc1);
+        }
+    }
+    for (; i + 7 < dim; i += 8) {
+        __m256 x0 = load_half8<kBf16>(x + i);
+        __m256 q0 = _mm256_loadu_ps(query + i);
+        if (kL2) {
+            __m256 d0 = _mm256_sub_ps(q0, x0);
+            acc0 = _mm256_fmadd_ps(d0, d0, acc0);
+        } else {
+            acc0 = _mm256_fmadd_ps(q0, x0, acc0);
+        }
+    }
+
+    float res = hsum_avx2(_mm256_add_ps(acc0, acc1));
+    for (; i < dim; ++i) {
+        float v = half_to_fp32<kBf16>(x[i]);
+        if (kL2) {
+            float diff = query[i] - v;
+            res += diff * diff;
+        } else {
+            res += query[i] * v;
+        }
+    }
+    return kL2 ? res : 1.0f - res;
+}
+
+float l2_distance_fp16_scalar(const float* query, const uint16_t* x, size_t dim) {
+    return half_distance_scalar<true, false>(query, x, dim);
+}
+float l2_distance_fp16_avx2(const float* query, const uint16_t* x, size_t dim) {
+    return half_distance_avx2<true, false>(query, x, dim);
+}
+float l2_distance_bf16_scalar(const float* query, const uint16_t* x, size_t dim) {
+    return half_distance_scalar<true, true>(query, x, dim);
+}
+float l2_distance_bf16_avx2(const float* query, const uint16_t* x, size_t dim) {
+    return half_distance_avx2<true, true>(query, x, dim);
+}
+float inner_product_distance_fp16_scalar(const float* query, const uint16_t* x, size_t dim) {
+    return half_distance_scalar<false, false>(query, x, dim);
+}
+float inner_product_distance_fp16_avx2(const float* query, const uint16_t* x, size_t dim) {
+    return half_distance_avx2<false, false>(query, x, dim);
+}
+float inner_product_distance_bf16_scalar(const float* query, const uint16_t* x, size_t dim) {
+    return half_distance_scalar<false, true>(query, x, dim);
+}
+float inner_product_distance_bf16_avx2(const float* query, const uint16_t* x, size_t dim) {
+    return half_distance_avx2<false, true>(query, x, dim);
+}
+
+HalfDistanceFunc get_half_distance_func(MetricType metric, VectorStorage storage, SimdLevel level) {
+    if (storage == VectorStorage::Float32) return nullptr;
+    bool l2 = (metric == MetricType::L2);
+    bool bf16 = (storage == VectorStorage::BFloat16);
+    if (half_avx2_available(level)) {
+        if (l2) return bf16 ? l2_distance_bf16_avx2 : l2_distance_fp16_avx2;
+        return bf16 ? inner_product_distance_bf16_avx2 : inner_product_distance_fp16_avx2;
+    }
+    if (l2) return bf16 ? l2_distance_bf16_scalar : l2_distance_fp16_scalar;
+    return bf16 ? inner_product_distance_bf16_scalar : inner_product_distance_fp16_scalar;
+}
+
+HalfDistanceFunc get_half_distance_func(MetricType metric, VectorStorage storage) {
+    return get_half_distance_func(metric, storage, detect_simd_level());
+}
+
+const char* vector_storage_name(VectorStorage storage) {
+    switch (storage) {
+        case VectorStorage::Float16: return "FP16";
+        case VectorStorage::BFloat16: return "BF16";
+        default: return "FP32";
+    }
+}
+
+// ==========================================
+// ֵֵĺ룺 1 ĸ
+// ==========================================
+uint32_t hamming_distance_scalar(const uint64_t* a, const uint64_t* b, size_t words) {
+    uint32_t sum = 0;
+    for (size_t i = 0; i < words; ++i) {
+        uint64_t x = a[i] ^ b[i];
+        // SWAR popcount popcnt ָ
+        x = x - ((x >> 1) & 0x5555555555555555ULL);
+        x = (x & 0x3333333333333333ULL) + ((x >> 2) & 0x3333333333333333ULL);
+        x = (x + (x >> 4)) & 0x0F0F0F0F0F0F0F0FULL;
+        sum += (uint32_t)((x * 0x0101010101010101ULL) >> 56);
+    }
+    return sum;
+}
+
+VS_TARGET_POPCNT
+uint32_t hamming_distance_popcnt(const uint64_t* a, const uint64_t* b, size_t words) {
+    uint64_t sum = 0;
+    for (size_t i = 0; i < words; ++i) {
+        sum += (uint64_t)_mm_popcnt_u64(a[i] ^ b[i]);
+    }
+    return (uint32_t)sum;
+}
+
+VS_TARGET_AVX2
+uint32_t hamming_distance_avx2(const uint64_t* a, const uint64_t* b, size_t words) {
+    // ֽڲ popcountvpshufb  16 õÿ 4 bit  1 ĸ
+    // vpsadbw ÿ 8 ֽںӳһ 64 λ
+    const __m256i lut = _mm256_setr_epi8(0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4,
+                                         0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4);
+    const __m256i low_mask = _mm256_set1_epi8(0x0F);
+    __m256i acc = _mm256_setzero_si256();
+
+    size_t i = 0;
+    for (; i + 3 < words; i += 4) {
+        __m256i x = _mm256_xor_si256(_mm256_loadu_si256((const __m256i*)(a + i)),
+                                     _mm256_loadu_si256((const __m256i*)(b + i)));
+        __m256i lo = _mm256_shuffle_epi8(lut, _mm256_and_si256(x, low_mask));
+        __m256i hi = _mm256_shuffle_epi8(lut, _mm256_and_si256(_mm256_srli_epi16(x, 4), low_mask));
+        acc = _mm256_add_epi64(acc, _mm256_sad_epu8(_mm256_add_epi8(lo, hi), _mm256_setzero_si256()));
+    }
+
+    __m128i sum128 = _mm_add_epi64(_mm256_castsi256_si128(acc), _mm256_extracti128_si256(acc, 1));
+    uint64_t sum = (uint64_t)_mm_cvtsi128_si64(sum128) + (uint64_t)_mm_extract_epi64(sum128, 1);
+    for (; i < words; ++i) {
+        sum += hamming_distance_scalar(a + i, b + i, 1);
+    }
+    return (uint32_t)sum;
+}
+
+static bool cpu_has_popcnt() {
+    static const bool has = []() {
+        __builtin_cpu_init();
+        return __builtin_cpu_supports("popcnt") != 0;
+    }();
+    return has;
+}
+
+HammingDistanceFunc get_hamming_distance_func(SimdLevel level, size_t words) {
+    // ֣128 ά֣ popcnt ꣬Ľ͹Լ
+    //  256 άĸ֣Ѿ죬 distance_bench  BM_Hamming*/256
+    if (level >= SimdLevel::AVX2 && words >= 4) return hamming_distance_avx2;
+    if (cpu_has_popcnt()) return hamming_distance_popcnt;
+    return hamming_distance_scalar;
+}
+
+HammingDistanceFunc get_hamming_distance_func(size_t words) {
+    return get_hamming_distance_func(detect_simd_level(), words);
+}
+
+// ==========================================
+// ѯ x ķֿGEMM ΢ںˣ
+// ==========================================
+void block_dot_scalar(const float* queries, size_t nq, const float* vecs, size_t nv, size_t dim, float* out) {
+    for (size_t i = 0; i < nq; ++i) {
+        const float* q = queries + i * dim;
+        for (size_t j = 0; j < nv; ++j) {
+            const float* x = vecs + j * dim;
+            float dot = 0.0f;
+            for (size_t d = 0; d < dim; ++d) {
+                dot += q[d] * x[d];
+            }
+            out[i * nv + j] = dot;
+        }
+    }
+}
+
+VS_TARGET_AVX2
+void block_dot_avx2(const float* queries, size_t nq, const float* vecs, size_t nv, size_t dim, float* out) {
+    // ΢ںһ 4 ѯ x 2 8 ۼ + 2 Ĵ + 1 ѯĴ
+    // ÿһֿ鱻 4 ѯãÿһѯֿ鱻 2 á
+    //  4 ѯ / 2 ı߽ظָ벹룬ֻǲдضǼУУ
+    for (size_t i = 0; i < nq; i += 4) {
+        size_t rows = std::min<size_t>(4, nq - i);
+        const float* q[4];
+        for (size_t r = 0; r < 4; ++r) {
+            q[r] = queries + (i + std::min(r, rows - 1)) * dim;
+        }
+
+        for (size_t j = 0; j < nv; j += 2) {
+            size_t cols = std::min<size_t>(2, nv - j);
+            const float* x0 = vecs + j * dim;
+            const float* x1 = vecs + (j + cols - 1) * dim;
+
+            __m256 a00 = _mm256_setzero_ps(), a01 = _mm256_setzero_ps();
+            __m256 a10 = _mm256_setzero_ps(), a11 = _mm256_setzero_ps();
+            __m256 a20 = _mm256_setzero_ps(), a21 = _mm256_setzero_ps();
+            __m256 a30 = _mm256_setzero_ps(), a31 = _mm256_setzero_ps();
+
+            size_t d = 0;
+            for (; d + 7 < dim; d += 8) {
+                __m256 v0 = _mm256_loadu_ps(x0 + d);
+                __m256 v1 = _mm256_loadu_ps(x1 + d);
+                __m256 qv = _mm256_loadu_ps(q[0] + d);
+                a00 = _mm256_fmadd_ps(qv, v0, a00);
+                a01 = _mm256_fmadd_ps(qv, v1, a01);
+                qv = _mm256_loadu_ps(q[1] + d);
+                a10 = _mm256_fmadd_ps(qv, v0, a10);
+                a11 = _mm256_fmadd_ps(qv, v1, a11);
+                qv = _mm256_loadu_ps(q[2] + d);
+                a20 = _mm256_fmadd_ps(qv, v0, a20);
+                a21 = _mm256_fmadd_ps(qv, v1, a21);
+                qv = _mm256_loadu_ps(q[3] + d);
+                a30 = _mm256_fmadd_ps(qv, v0, a30);
+                a31 = _mm256_fmadd_ps(qv, v1, a31);
+            }
+
+            float dots0[4], dots1[4];
+            _mm_storeu_ps(dots0, hsum4_avx2(a00, a10, a20, a30));
+            _mm_storeu_ps(dots1, hsum4_avx2(a01, a11, a21, a31));
+            for (; d < dim; ++d) {
+                for (size_t r = 0; r < 4; ++r) {
+                    dots0[r] += q[r][d] * x0[d];
+                    dots1[r] += q[r][d] * x1[d];
+                }
+            }
+
+            for (size_t r = 0; r < rows; ++r) {
+                out[(i + r) * nv + j] = dots0[r];
+                if (cols == 2) out[(i + r) * nv + j + 1] = dots1[r];
+            }
+        }
+    }
+}
+
+BlockDotFunc get_block_dot_func(SimdLevel level) {
+    return (level >= SimdLevel::AVX2) ? block_dot_avx2 : block_dot_scalar;
+}
+
+BlockDotFunc get_block_dot_func() {
+    return get_block_dot_func(detect_simd_level());
+}
+
+// ==========================================
+// Թλͼ
+// ==========================================
+void filter_bitmap_scalar(const uint32_t* tags, const uint64_t* labels, size_t n, uint32_t tag,
+                          uint32_t tag_mask, uint64_t all, uint64_t any, uint64_t* out) {
+    std::memset(out, 0, (n + 63) / 64 * sizeof(uint64_t));
+    for (size_t i = 0; i < n; ++i) {
+        bool hit = (tags[i] & tag_mask) == tag && (labels[i] & all) == all && (any == 0 || (labels[i] & any) != 0);
+        out[i >> 6] |= (uint64_t)hit << (i & 63);
+    }
+}
+
+VS_TARGET_AVX2
+void filter_bitmap_avx2(const uint32_t* tags, const uint64_t* labels, size_t n, uint32_t tag,
+                        uint32_t tag_mask, uint64_t all, uint64_t any, uint64_t* out) {
+    std::memset(out, 0, (n + 63) / 64 * sizeof(uint64_t));
+    const __m256i tag_v = _mm256_set1_epi32((int)tag);
+    const __m256i tag_mask_v = _mm256_set1_epi32((int)tag_mask);
+    const __m256i all_v = _mm256_set1_epi64x((long long)all);
+    const __m256i any_v = _mm256_set1_epi64x((long long)any);
+    const __m256i zero = _mm256_setzero_si256();
+
+    // һ 8 λtag һ 256 λĴǩλͼ64 λȽϵ movemask_pd  4 λ
+    // 32 λȽϵ movemask_ps  8 λƴһֽڡ8 ı뵽ڣ
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m256i t = _mm256_and_si256(_mm256_loadu_si256((const __m256i*)(tags + i)), tag_mask_v);
+        uint32_t bits = (uint32_t)_mm256_movemask_ps(_mm256_castsi256_ps(_mm256_cmpeq_epi32(t, tag_v)));
+        if (bits != 0 && (all | any) != 0) {
+            __m256i l0 = _mm256_loadu_si256((const __m256i*)(labels + i));
+            __m256i l1 = _mm256_loadu_si256((const __m256i*)(labels + i + 4));
+            __m256i ok0 = _mm256_cmpeq_epi64(_mm256_and_si256(l0, all_v), all_v);
+            __m256i ok1 = _mm256_cmpeq_epi64(_mm256_and_si256(l1, all_v), all_v);
+            if (any != 0) {
+                //  any ûнĲλand Ϊ 0cmpeq ȫ 1andnot 
+                ok0 = _mm256_andnot_si256(_mm256_cmpeq_epi64(_mm256_and_si256(l0, any_v), zero), ok0);
+                ok1 = _mm256_andnot_si256(_mm256_cmpeq_epi64(_mm256_and_si256(l1, any_v), zero), ok1);
+            }
+            uint32_t label_bits = (uint32_t)_mm256_movemask_pd(_mm256_castsi256_pd(ok0)) |
+                                  ((uint32_t)_mm256_movemask_pd(_mm256_castsi256_pd(ok1)) << 4);
+            bits &= label_bits;
+        }
+        out[i >> 6] |= (uint64_t)bits << (i & 63);
+    }
+    for (; i < n; ++i) {
+        bool hit = (tags[i] & tag_mask) == tag && (labels[i] & all) == all && (any == 0 || (labels[i] & any) != 0);
+        out[i >> 6] |= (uint64_t)hit << (i & 63);
+    }
+}
+
+FilterBitmapFunc get_filter_bitmap_func(SimdLevel level) {
+    return (level >= SimdLevel::AVX2) ? filter_bitmap_avx2 : filter_bitmap_scalar;
+}
+
+FilterBitmapFunc get_filter_bitmap_func() {
+    return get_filter_bitmap_func(detect_simd_level());
+}
+
+SimdLevel detect_simd_level() {
+    // ھ̬̰߳ȫֻ̽һ CPUID
+    static const SimdLevel level = []() {
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports("avx512f")) return SimdLevel::AVX512;
+        if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma")) return SimdLevel::AVX2;
+        if (__builtin_cpu_supports("sse2")) return SimdLevel::SSE;
+        return SimdLevel::Scalar;
+    }();
+    return level;
+}
+
+const char* simd_level_name(SimdLevel level) {
+    switch (level) {
+        case SimdLevel::AVX512: return "AVX512";
+        case SimdLevel::AVX2: return "AVX2";
+        case SimdLevel::SSE: return "SSE";
+        default: return "Scalar";
+    }
+}
+
+DistanceFunc get_l2_distance_func(SimdLevel level) {
+    switch (level) {
+        case SimdLevel::AVX512: return l2_distance_avx512;
+        case SimdLevel::AVX2: return l2_distance_avx2;
+        case SimdLevel::SSE: return l2_distance_sse;
+        default: return l2_distance_scalar;
+    }
+}
+
+DistanceFunc get_inner_product_distance_func(SimdLevel level) {
+    switch (level) {
+        case SimdLevel::AVX512: return inner_product_distance_avx512;
+        case SimdLevel::AVX2: return inner_product_distance_avx2;
+        case SimdLevel::SSE: return inner_product_distance_sse;
+        default: return inner_product_distance_scalar;
+    }
+}
+
+DistanceFunc get_distance_func(MetricType metric, size_t dim) {
+    SimdLevel level = detect_simd_level();
+    DistanceFunc fixed = get_fixed_dim_distance_func(metric, level, dim);
+    if (fixed != nullptr) return fixed;
+    if (metric == MetricType::L2) return get_l2_distance_func(level);
+    return get_inner_product_distance_func(level);
+}
+
+// ַָʼָʼܾ̬ʼ˳Ӱ죩
+// һεʱ̽ CPU Լ滻ں
+static float l2_distance_resolve(const float* a, const float* b, size_t dim);
+static std::atomic<DistanceFunc> g_l2_distance{l2_distance_resolve};
+
+static float l2_distance_resolve(const float* a, const float* b, size_t dim) {
+    DistanceFunc func = get_l2_distance_func(detect_simd_level());
+    g_l2_distance.store(func, std::memory_order_relaxed);
+    return func(a, b, dim);
+}
+
+float l2_distance(const float* a, const float* b, size_t dim) {
+    return g_l2_distance.load(std::memory_order_relaxed)(a, b, dim);
+}
+
+} // namespace vector_search
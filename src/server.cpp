@@ -9,8 +9,23 @@
 
 using namespace vector_search;
 
+DEFINE_string(metric, "l2", "Distance metric of the index: l2 / ip / cosine");
+DEFINE_bool(sq8, false, "Traverse the graph on SQ8 codes and rerank the top-k with floats (l2 only)");
+DEFINE_string(storage, "fp32", "Vector storage precision of the index and write buffers: fp32 / fp16 / bf16");
+DEFINE_bool(binary_prefilter, false, "Screen neighbors on 1-bit codes (Hamming distance) before scoring them with floats");
+DEFINE_bool(colocate, false, "Let the index own a copy of each vector, stored next to its level-0 neighbors in one cache-aligned block");
+DEFINE_bool(reorder, false, "Renumber graph nodes in BFS order after the bulk load so neighbors sit close in memory");
+DEFINE_bool(serve_during_load, false, "Start serving RPCs before the bulk load finishes; searches see whatever has been loaded so far");
+DEFINE_string(build_mode, "insert", "How the bulk load builds the graph: insert (parallel insert_bulk) / nndescent (NN-Descent kNN graph, then HNSW edges)");
+DEFINE_int32(visited_pool_limit, 0, "Max number of full-size visited tables shared by all searches, 0 means one per CPU core");
+DEFINE_int32(pq_m, 0, "Traverse the graph on PQ codes with this many subspaces, 0 disables (l2 only)");
+DEFINE_int32(tenants, 0, "Tag each base vector with tenant id (id % tenants) for filtered-search testing, 0 leaves base vectors untagged");
+DEFINE_int32(insert_headroom, 100000, "Index capacity reserved beyond the base set for ids written through Insert");
+
 bvar::LatencyRecorder g_search_latency("vector_search", "search_latency");
+bvar::LatencyRecorder g_batch_search_latency("vector_search", "batch_search_latency");
 bvar::LatencyRecorder g_insert_latency("vector_search", "insert_latency"); // д
+bvar::LatencyRecorder g_delete_latency("vector_search", "delete_latency");
 
 class VectorSearchServiceImpl : public pb::VectorSearchService {
 public:
@@ -31,9 +46,21 @@ public:
 
         std::vector<float> query(request->query_vector().begin(), request->query_vector().end());
         try {
-            // ö·鲢 engine_->search_knn
-            auto results = engine_->search_knn(query.data(), request->k(), request->ef_search());
-            for (auto id : results) response->add_ids(id);
+            // ö·鲢 engine_->search_knnĴӳ裬黹
+            ScopedSearchContext ctx(engine_->search_context_pool());
+            AttributeFilter filter;
+            if (request->has_filter()) {
+                filter.match_tag = request->filter().match_tag();
+                filter.tag = request->filter().tag();
+                filter.all_labels = request->filter().all_labels();
+                filter.any_labels = request->filter().any_labels();
+            }
+            auto results = engine_->search_knn(query.data(), request->k(), request->ef_search(), ctx.get(),
+                                               filter.empty() ? nullptr : &filter);
+            for (const auto& nd : results) {
+                response->add_ids(nd.id);
+                response->add_distances(nd.dist);
+            }
             response->set_code(0);
         } catch (...) {
             response->set_code(-2);
@@ -41,6 +68,39 @@ public:
         g_search_latency << (butil::gettimeofday_us() - start_time_us); 
     }
 
+    // һѯһдɨ
+    virtual void BatchSearch(google::protobuf::RpcController* cntl_base,
+                             const pb::BatchSearchRequest* request,
+                             pb::BatchSearchResponse* response,
+                             google::protobuf::Closure* done) {
+        brpc::ClosureGuard done_guard(done);
+        int64_t start_time_us = butil::gettimeofday_us();
+
+        if (request->query_vectors_size() == 0 || request->query_vectors_size() % 128 != 0) {
+            response->set_code(-1);
+            return;
+        }
+
+        size_t nq = request->query_vectors_size() / 128;
+        std::vector<float> queries(request->query_vectors().begin(), request->query_vectors().end());
+        try {
+            ScopedSearchContext ctx(engine_->search_context_pool());
+            auto results = engine_->search_knn_batch(queries.data(), nq, request->k(), request->ef_search(), ctx.get());
+            for (auto& ids : results) {
+                pb::SearchResponse* result = response->add_results();
+                for (const auto& nd : ids) {
+                    result->add_ids(nd.id);
+                    result->add_distances(nd.dist);
+                }
+                result->set_code(0);
+            }
+            response->set_code(0);
+        } catch (...) {
+            response->set_code(-2);
+        }
+        g_batch_search_latency << (butil::gettimeofday_us() - start_time_us);
+    }
+
     // ʵӵ Insert ӿ
     virtual void Insert(google::protobuf::RpcController* cntl_base,
                         const pb::InsertRequest* request,
@@ -57,7 +117,7 @@ public:
         std::vector<float> vec(request->vector().begin(), request->vector().end());
         try {
             // дֱӴ뼫ǰ̨ Buffer
-            engine_->insert(vec.data(), request->id());
+            engine_->insert(vec.data(), request->id(), {request->tag(), request->labels()});
             response->set_code(0);
         } catch (...) {
             response->set_code(-2);
@@ -65,52 +125,143 @@ public:
         g_insert_latency << (butil::gettimeofday_us() - start_time_us);
     }
 
+    // ɾĹأͼ޸ĺ̨߳
+    virtual void Delete(google::protobuf::RpcController* cntl_base,
+                        const pb::DeleteRequest* request,
+                        pb::DeleteResponse* response,
+                        google::protobuf::Closure* done) {
+        brpc::ClosureGuard done_guard(done);
+        int64_t start_time_us = butil::gettimeofday_us();
+
+        try {
+            if (engine_->remove(request->id())) {
+                response->set_code(0);
+            } else {
+                response->set_code(-3);
+                response->set_message("id not found");
+            }
+        } catch (...) {
+            response->set_code(-2);
+        }
+        g_delete_latency << (butil::gettimeofday_us() - start_time_us);
+    }
+
 private:
     VectorEngine* engine_;
 };
 
+// Ķֽ MetricTypeδֱ֪Ӿܾ
+static bool parse_metric(const std::string& name, MetricType* metric) {
+    if (name == "l2") { *metric = MetricType::L2; return true; }
+    if (name == "ip") { *metric = MetricType::InnerProduct; return true; }
+    if (name == "cosine") { *metric = MetricType::Cosine; return true; }
+    return false;
+}
+
+// visited صļָ꣺ǰ
+static size_t get_visited_pool_size(void* arg) {
+    return static_cast<HnswIndex*>(arg)->visited_pool().size();
+}
+
+static double get_visited_pool_hit_rate(void* arg) {
+    return static_cast<HnswIndex*>(arg)->visited_pool().hit_rate();
+}
+
+static size_t get_neighbor_slab_reserved(void*) {
+    return NeighborListPool::get_instance().reserved_bytes();
+}
+
+static double get_neighbor_slab_fragmentation(void*) {
+    return NeighborListPool::get_instance().fragmentation();
+}
+
+// ɾļָ꣺ĹĽڵûͼĽڵ
+static size_t get_deleted_count(void* arg) {
+    return static_cast<HnswIndex*>(arg)->deleted_count();
+}
+
+static size_t get_pending_repair_count(void* arg) {
+    return static_cast<HnswIndex*>(arg)->pending_repair_count();
+}
+
+static bool parse_storage(const std::string& name, VectorStorage* storage) {
+    if (name == "fp32") { *storage = VectorStorage::Float32; return true; }
+    if (name == "fp16") { *storage = VectorStorage::Float16; return true; }
+    if (name == "bf16") { *storage = VectorStorage::BFloat16; return true; }
+    return false;
+}
+
 int main(int argc, char* argv[]) {
+    google::ParseCommandLineFlags(&argc, &argv, true);
+    MetricType metric;
+    if (!parse_metric(FLAGS_metric, &metric)) {
+        std::cerr << "Unknown --metric: " << FLAGS_metric << std::endl;
+        return -1;
+    }
+    VectorStorage storage;
+    if (!parse_storage(FLAGS_storage, &storage)) {
+        std::cerr << "Unknown --storage: " << FLAGS_storage << std::endl;
+        return -1;
+    }
+    if ((FLAGS_sq8 || FLAGS_pq_m > 0) && metric != MetricType::L2) {
+        std::cerr << "--sq8 / --pq_m only support --metric=l2" << std::endl;
+        return -1;
+    }
+    if (FLAGS_sq8 && FLAGS_pq_m > 0) {
+        std::cerr << "--sq8 and --pq_m are mutually exclusive" << std::endl;
+        return -1;
+    }
+    if (FLAGS_reorder && FLAGS_serve_during_load) {
+        std::cerr << "--reorder needs a quiescent index and cannot be combined with --serve_during_load" << std::endl;
+        return -1;
+    }
+    if (FLAGS_build_mode != "insert" && FLAGS_build_mode != "nndescent") {
+        std::cerr << "Unknown --build_mode: " << FLAGS_build_mode << std::endl;
+        return -1;
+    }
+    if (FLAGS_build_mode == "nndescent" && FLAGS_serve_during_load) {
+        std::cerr << "--build_mode=nndescent only links the graph at the end and cannot be combined with --serve_during_load" << std::endl;
+        return -1;
+    }
+
     std::cout << "Loading base data into Vector Engine..." << std::endl;
     size_t dim, num;
     auto base_data = load_fvecs("../data/sift/sift_base.fvecs", dim, num);
     
-    // ʼǵĶ Engine (Buffer5)
-    VectorEngine engine(dim, 1000000, 16, 200, 50000, 2);
-    
-    // Bulk Load ģʽ CPU ģֱӲдײͼ
-    std::cout << "Starting Bulk Load Phase (Using all CPU cores)..." << std::endl;
-    int num_threads = std::thread::hardware_concurrency();
-    std::vector<std::thread> build_threads;
-    std::atomic<size_t> built_count{0};
-    
-    int64_t start_build = butil::gettimeofday_us();
+    // ʼǵĶ Engine (Ϊ׿дԤBuffer5)
+    // Insert  id ᱻܾcode -2ͻѹ id  100 ʼ
+    VectorEngine engine(dim, num + FLAGS_insert_headroom, 16, 200, 50000, 2, metric, storage,
+                        FLAGS_colocate ? NodeLayout::Colocated : NodeLayout::Separate);
 
-    for (int t = 0; t < num_threads; ++t) {
-        build_threads.emplace_back([&, t]() {
-            // ÿ߳Ծʽطֵ׿
-            for (size_t i = t; i < num; i += num_threads) {
-                
-                // ƹ engine.insert ǰ̨壬ר Bulk Load Ľӿڣֱԭؽͼ
-                engine.get_raw_index()->insert_bulk(base_data.data() + i * dim, i);
-                
-                size_t current = built_count.fetch_add(1, std::memory_order_relaxed);
-                // ӡ
-                if ((current + 1) % 100000 == 0) {
-                    std::cout << "Actually built into graph: " << (current + 1) << " / " << num << std::endl;
-                }
-            }
-        });
+    if (FLAGS_visited_pool_limit > 0) {
+        engine.get_raw_index()->set_visited_pool_limit(FLAGS_visited_pool_limit);
     }
+    bvar::PassiveStatus<size_t> visited_pool_size("vector_search", "visited_pool_size",
+                                                  get_visited_pool_size, engine.get_raw_index());
+    bvar::PassiveStatus<double> visited_pool_hit_rate("vector_search", "visited_pool_hit_rate",
+                                                      get_visited_pool_hit_rate, engine.get_raw_index());
+    bvar::PassiveStatus<size_t> neighbor_slab_reserved("vector_search", "neighbor_slab_reserved_bytes",
+                                                       get_neighbor_slab_reserved, nullptr);
+    bvar::PassiveStatus<size_t> deleted_nodes("vector_search", "deleted_nodes",
+                                              get_deleted_count, engine.get_raw_index());
+    bvar::PassiveStatus<size_t> pending_repair_nodes("vector_search", "pending_repair_nodes",
+                                                     get_pending_repair_count, engine.get_raw_index());
+    bvar::PassiveStatus<double> neighbor_slab_fragmentation("vector_search", "neighbor_slab_fragmentation",
+                                                            get_neighbor_slab_fragmentation, nullptr);
 
-    // ȴнͼ߳
-    for (auto& t : build_threads) {
-        t.join();
+    // SQ8ȫ׿ѵbulk load ʱÿڵ˳ֱ
+    if (FLAGS_sq8) {
+        engine.get_raw_index()->train_sq8(base_data.data(), num);
+    }
+    // PQk-means ѵ뱾bulk load ʱÿڵ˳ֱ
+    if (FLAGS_pq_m > 0) {
+        engine.get_raw_index()->train_pq(base_data.data(), num, FLAGS_pq_m);
+    }
+    // ֵԤɸȫ׿ѵÿһάλbulk load ʱÿڵ˳ֱ
+    if (FLAGS_binary_prefilter) {
+        engine.get_raw_index()->train_binary_prefilter(base_data.data(), num);
     }
     
-    double build_time = (butil::gettimeofday_us() - start_build) / 1000000.0;
-    std::cout << "Bulk Load completely finished in " << build_time << " seconds." << std::endl;
-    std::cout << "Engine transition to Streaming Mode. Ready for RPC requests." << std::endl;
-
     brpc::Server server;
     VectorSearchServiceImpl vector_service(&engine);
 
@@ -118,9 +269,59 @@ int main(int argc, char* argv[]) {
 
     brpc::ServerOptions options;
     options.idle_timeout_sec = -1;
-    if (server.Start(8000, &options) != 0) return -1;
 
-    std::cout << "VectorSearchServer running on port 8000" << std::endl;
+    // ߵ߷insert_bulk ԭ޸нڵ汾űѯ޸ĵھӱض
+    if (FLAGS_serve_during_load) {
+        if (server.Start(8000, &options) != 0) return -1;
+        std::cout << "VectorSearchServer running on port 8000 while the bulk load is in progress" << std::endl;
+    }
+
+    // ڽͼǰдãڵһͼܱ˲ѯȷж
+    if (FLAGS_tenants > 0) {
+        for (size_t i = 0; i < num; ++i) {
+            engine.get_raw_index()->set_attributes((uint32_t)i, {(uint32_t)(i % FLAGS_tenants), 0});
+        }
+    }
+
+    // Bulk Load ģʽ CPU ģֱӲдײͼ
+    std::cout << "Starting Bulk Load Phase (Using all CPU cores)..." << std::endl;
+    int64_t start_build = butil::gettimeofday_us();
+
+    if (FLAGS_build_mode == "nndescent") {
+        // Ƚ kNN ͼһ HNSW ıߣȫǰɲѯ
+        int iterations = engine.get_raw_index()->build_nndescent(base_data.data(), num);
+        std::cout << "NN-Descent converged after " << iterations << " iterations." << std::endl;
+    } else {
+        // ƹ engine.insert ǰ̨壬ɹȡ insert_bulk ֱԭؽͼ
+        size_t reported = 0;
+        engine.get_raw_index()->insert_batch(base_data.data(), nullptr, num, 0, [&](size_t done, size_t total) {
+            // ӡصִУreported Ҫͬ
+            if (done / 100000 > reported) {
+                reported = done / 100000;
+                std::cout << "Actually built into graph: " << done << " / " << total << std::endl;
+            }
+        });
+    }
+
+    double build_time = (butil::gettimeofday_us() - start_build) / 1000000.0;
+    std::cout << "Bulk Load completely finished in " << build_time << " seconds." << std::endl;
+    const NeighborListPool& list_pool = NeighborListPool::get_instance();
+    std::cout << "Neighbor list slab: " << list_pool.allocations() << " lists, "
+              << list_pool.reserved_bytes() / (1024 * 1024) << " MB reserved, fragmentation "
+              << list_pool.fragmentation() * 100.0 << " %; process RSS "
+              << read_rss_bytes() / (1024 * 1024) << " MB" << std::endl;
+
+    // űڶǰɣʱûκβд
+    if (FLAGS_reorder) {
+        engine.get_raw_index()->reorder_graph();
+        std::cout << "Graph reordered for memory locality." << std::endl;
+    }
+    std::cout << "Engine transition to Streaming Mode. Ready for RPC requests." << std::endl;
+
+    if (!FLAGS_serve_during_load) {
+        if (server.Start(8000, &options) != 0) return -1;
+        std::cout << "VectorSearchServer running on port 8000" << std::endl;
+    }
     server.RunUntilAskedToQuit();
     return 0;
 }
\ No newline at end of file